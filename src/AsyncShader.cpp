@@ -0,0 +1,357 @@
+//
+//  AsyncShader.cpp
+//  depthBlur
+//
+//
+
+#include "AsyncShader.h"
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+bool AsyncShader::isParallelCompileSupported() {
+    static int supported = -1;
+    if (supported<0) {
+        supported = 0;
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (int i=0;i<count;i++) {
+            const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+            if (name && (string(name)=="GL_KHR_parallel_shader_compile" || string(name)=="GL_ARB_parallel_shader_compile")) {
+                supported = 1;
+            }
+        }
+    }
+    return supported;
+}
+
+AsyncShader::AsyncShader() {
+    program = 0;
+    pending = 0;
+    shaders[0] = shaders[1] = 0;
+    stage = STAGE_IDLE;
+    buildMillis = 0;
+    blockedMillis = 0;
+    vao = 0;
+    vbo = 0;
+    meshVao = 0;
+    meshVbo = 0;
+}
+
+AsyncShader::~AsyncShader() {
+    discard();
+    if (program) {
+        glDeleteProgram(program);
+    }
+    if (vao) {
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &vbo);
+    }
+    if (meshVao) {
+        glDeleteVertexArrays(1, &meshVao);
+        glDeleteBuffers(1, &meshVbo);
+    }
+}
+
+void AsyncShader::discard() {
+    for (int i=0;i<2;i++) {
+        if (shaders[i]) {
+            glDeleteShader(shaders[i]);
+            shaders[i] = 0;
+        }
+    }
+    if (pending) {
+        glDeleteProgram(pending);
+        pending = 0;
+    }
+    stage = STAGE_IDLE;
+}
+
+void AsyncShader::load(const string &vertex,const string &fragment) {
+    discard();
+    
+    unsigned long long start = ofGetElapsedTimeMicros();
+    submitTime = start;
+    
+    const GLenum types[2] = {GL_VERTEX_SHADER,GL_FRAGMENT_SHADER};
+    const string *sources[2] = {&vertex,&fragment};
+    for (int i=0;i<2;i++) {
+        shaders[i] = glCreateShader(types[i]);
+        const char *source = sources[i]->c_str();
+        glShaderSource(shaders[i], 1, &source, NULL);
+        glCompileShader(shaders[i]);
+    }
+    stage = STAGE_COMPILING;
+    
+    blockedMillis = (ofGetElapsedTimeMicros()-start)/1000.0;
+}
+
+void AsyncShader::load(const string &fragment) {
+    load(getSimpleVertex(), fragment);
+}
+
+// without the extension the status query itself waits, it is only made a frame later
+bool AsyncShader::isComplete(GLuint object,bool program) {
+    if (!isParallelCompileSupported()) {
+        return true;
+    }
+    GLint complete = GL_FALSE;
+    if (program) {
+        glGetProgramiv(object, GL_COMPLETION_STATUS_KHR, &complete);
+    } else {
+        glGetShaderiv(object, GL_COMPLETION_STATUS_KHR, &complete);
+    }
+    return complete;
+}
+
+void AsyncShader::logErrors(GLuint object,bool program) {
+    GLint length = 0;
+    if (program) {
+        glGetProgramiv(object, GL_INFO_LOG_LENGTH, &length);
+    } else {
+        glGetShaderiv(object, GL_INFO_LOG_LENGTH, &length);
+    }
+    vector<GLchar> log(max(length,1));
+    if (program) {
+        glGetProgramInfoLog(object, log.size(), NULL, &log[0]);
+    } else {
+        glGetShaderInfoLog(object, log.size(), NULL, &log[0]);
+    }
+    ofLogError("AsyncShader") << (program ? "link failed: " : "compile failed: ") << &log[0];
+}
+
+bool AsyncShader::update() {
+    if (stage==STAGE_IDLE) {
+        return false;
+    }
+    
+    unsigned long long start = ofGetElapsedTimeMicros();
+    bool current = false;
+    
+    if (stage==STAGE_COMPILING) {
+        if (isComplete(shaders[0], false) && isComplete(shaders[1], false)) {
+            pending = glCreateProgram();
+            glAttachShader(pending, shaders[0]);
+            glAttachShader(pending, shaders[1]);
+            // the attribute locations of ofShader::bindDefaults
+            glBindAttribLocation(pending, 0, "position");
+            glBindAttribLocation(pending, 1, "color");
+            glBindAttribLocation(pending, 2, "normal");
+            glBindAttribLocation(pending, 3, "texcoord");
+            glLinkProgram(pending);
+            stage = STAGE_LINKING;
+        }
+    } else if (stage==STAGE_LINKING) {
+        if (isComplete(pending, true)) {
+            GLint status;
+            glGetProgramiv(pending, GL_LINK_STATUS, &status);
+            if (status) {
+                for (int i=0;i<2;i++) {
+                    glDeleteShader(shaders[i]);
+                    shaders[i] = 0;
+                }
+                if (program) {
+                    glDeleteProgram(program);
+                }
+                program = pending;
+                pending = 0;
+                current = true;
+                buildMillis = (ofGetElapsedTimeMicros()-submitTime)/1000.0;
+                stage = STAGE_IDLE;
+            } else {
+                for (int i=0;i<2;i++) {
+                    GLint compiled;
+                    glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compiled);
+                    if (!compiled) {
+                        logErrors(shaders[i], false);
+                    }
+                }
+                logErrors(pending, true);
+                discard();
+            }
+        }
+    }
+    
+    blockedMillis += (ofGetElapsedTimeMicros()-start)/1000.0;
+    return current;
+}
+
+bool AsyncShader::isReady() {
+    return program!=0;
+}
+
+bool AsyncShader::isPending() {
+    return stage!=STAGE_IDLE;
+}
+
+GLuint AsyncShader::getProgram() {
+    return program;
+}
+
+float AsyncShader::getBuildMillis() {
+    return buildMillis;
+}
+
+float AsyncShader::getBlockedMillis() {
+    return blockedMillis;
+}
+
+void AsyncShader::begin() {
+    begin(ofMatrix4x4());
+}
+
+void AsyncShader::begin(const ofMatrix4x4 &modelViewProjection) {
+    glUseProgram(program);
+    glUniformMatrix4fv(glGetUniformLocation(program, "modelViewProjectionMatrix"), 1, GL_FALSE, modelViewProjection.getPtr());
+}
+
+void AsyncShader::end() {
+    glUseProgram(0);
+}
+
+void AsyncShader::draw() {
+    if (!vao) {
+        // x, y, z, w, s, t
+        const float quad[4][6] = {{-1,-1,0,1,0,0},{1,-1,0,1,1,0},{1,1,0,1,1,1},{-1,1,0,1,0,1}};
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 6*sizeof(float), 0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void *)(4*sizeof(float)));
+        glEnableVertexAttribArray(3);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    
+    GLint previousVao;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVao);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    glBindVertexArray(previousVao);
+}
+
+void AsyncShader::draw(const ofMesh &mesh) {
+    const vector<ofVec3f> &vertices = mesh.getVertices();
+    const vector<ofVec2f> &texCoords = mesh.getTexCoords();
+    if (vertices.empty()) {
+        return;
+    }
+    
+    // the layout of the quad in draw()
+    vector<float> data(vertices.size()*6, 0);
+    for (int i=0;i<vertices.size();i++) {
+        float *vertex = &data[i*6];
+        vertex[0] = vertices[i].x;
+        vertex[1] = vertices[i].y;
+        vertex[2] = vertices[i].z;
+        vertex[3] = 1;
+        if (i<texCoords.size()) {
+            vertex[4] = texCoords[i].x;
+            vertex[5] = texCoords[i].y;
+        }
+    }
+    
+    GLint previousVao;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVao);
+    if (!meshVao) {
+        glGenVertexArrays(1, &meshVao);
+        glGenBuffers(1, &meshVbo);
+        glBindVertexArray(meshVao);
+        glBindBuffer(GL_ARRAY_BUFFER, meshVbo);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 6*sizeof(float), 0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void *)(4*sizeof(float)));
+        glEnableVertexAttribArray(3);
+    } else {
+        glBindVertexArray(meshVao);
+        glBindBuffer(GL_ARRAY_BUFFER, meshVbo);
+    }
+    glBufferData(GL_ARRAY_BUFFER, data.size()*sizeof(float), &data[0], GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDrawArrays(ofGetGLPrimitiveMode(mesh.getMode()), 0, vertices.size());
+    glBindVertexArray(previousVao);
+}
+
+void AsyncShader::setUniform1i(string name,int value) {
+    glUniform1i(glGetUniformLocation(program, name.c_str()), value);
+}
+
+void AsyncShader::setUniform1f(string name,float value) {
+    glUniform1f(glGetUniformLocation(program, name.c_str()), value);
+}
+
+void AsyncShader::setUniform2f(string name,float x,float y) {
+    glUniform2f(glGetUniformLocation(program, name.c_str()), x, y);
+}
+
+void AsyncShader::setUniform1fv(string name,const float *values,int count) {
+    glUniform1fv(glGetUniformLocation(program, name.c_str()), count, values);
+}
+
+void AsyncShader::setUniformTexture(string name,ofTexture &texture,int unit) {
+    ofTextureData &data = texture.getTextureData();
+    setUniformTexture(name, data.textureTarget, data.textureID, unit);
+}
+
+void AsyncShader::setUniformTexture(string name,GLenum target,GLuint texture,int unit) {
+    glActiveTexture(GL_TEXTURE0+unit);
+    glBindTexture(target, texture);
+    glUniform1i(glGetUniformLocation(program, name.c_str()), unit);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void ShaderWarmup::add(AsyncShader &shader,const string &vertex,const string &fragment) {
+    for (deque<Job>::iterator iter=queue.begin();iter!=queue.end();iter++) {
+        if (iter->shader==&shader) {
+            iter->vertex = vertex;
+            iter->fragment = fragment;
+            return;
+        }
+    }
+    
+    Job job;
+    job.shader = &shader;
+    job.vertex = vertex;
+    job.fragment = fragment;
+    queue.push_back(job);
+}
+
+void ShaderWarmup::update(float budget) {
+    unsigned long long start = ofGetElapsedTimeMicros();
+    
+    // without the parallel compile extension every step can block, so the steps of the
+    // builds in flight count against the budget too. at least one step or submit per frame
+    // so a tight budget still makes progress
+    bool first = true;
+    for (vector<AsyncShader *>::iterator iter=building.begin();iter!=building.end() && (first || (ofGetElapsedTimeMicros()-start)/1000.0<budget);) {
+        (*iter)->update();
+        first = false;
+        if ((*iter)->isPending()) {
+            iter++;
+        } else {
+            iter = building.erase(iter);
+        }
+    }
+    
+    while (!queue.empty() && (first || (ofGetElapsedTimeMicros()-start)/1000.0<budget)) {
+        Job &job = queue.front();
+        job.shader->load(job.vertex, job.fragment);
+        // a shader already building restarted with the new sources
+        if (find(building.begin(), building.end(), job.shader)==building.end()) {
+            building.push_back(job.shader);
+        }
+        queue.pop_front();
+        first = false;
+    }
+}
+
+bool ShaderWarmup::isDone() {
+    return queue.empty() && building.empty();
+}
+
+int ShaderWarmup::getNumPending() {
+    return queue.size()+building.size();
+}
@@ -0,0 +1,99 @@
+//
+//  AsyncShader.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "Shaders.h"
+
+// a program built without blocking the render thread. with GL_KHR_parallel_shader_compile
+// the driver compiles on its own threads and readiness is polled. without it glCompileShader,
+// glLinkProgram and the status check still block inside the driver, they only land on
+// separate frames, so a large shader still costs a hitch on each of them.
+// the previous program stays in use until the new one is linked.
+// draw() covers the bound target with texcoords 0..1 and an identity
+// modelViewProjectionMatrix, so fragments of createSimpleShader work unchanged.
+// ShaderChain drives the linked program directly (addPass(AsyncShader&)), it is never
+// rebuilt as an ofShader
+class AsyncShader {
+public:
+    
+    AsyncShader();
+    ~AsyncShader();
+    
+    void load(const string &vertex,const string &fragment);
+    void load(const string &fragment); // with getSimpleVertex(), as createSimpleShader
+    bool update(); // once per frame, true when a new program became current
+    
+    bool isReady(); // a linked program is in use
+    bool isPending(); // a build is in flight
+    GLuint getProgram();
+    float getBuildMillis(); // submit to current, of the last build
+    float getBlockedMillis(); // spent in gl calls of the last build on this thread
+    
+    void begin(); // identity modelViewProjectionMatrix
+    void begin(const ofMatrix4x4 &modelViewProjection);
+    void end();
+    void draw();
+    void draw(const ofMesh &mesh); // positions and texcoords, streamed without the renderer
+    
+    void setUniform1i(string name,int value);
+    void setUniform1f(string name,float value);
+    void setUniform2f(string name,float x,float y);
+    void setUniform1fv(string name,const float *values,int count);
+    void setUniformTexture(string name,ofTexture &texture,int unit);
+    void setUniformTexture(string name,GLenum target,GLuint texture,int unit);
+    
+    static bool isParallelCompileSupported();
+    
+private:
+    
+    enum Stage {
+        STAGE_IDLE,
+        STAGE_COMPILING,
+        STAGE_LINKING
+    };
+    
+    void discard();
+    bool isComplete(GLuint object,bool program);
+    void logErrors(GLuint object,bool program);
+    
+    GLuint program;
+    GLuint pending;
+    GLuint shaders[2];
+    Stage stage;
+    unsigned long long submitTime;
+    float buildMillis;
+    float blockedMillis;
+    GLuint vao;
+    GLuint vbo;
+    GLuint meshVao;
+    GLuint meshVbo;
+};
+
+// builds declared variants a few at a time so starting them never costs a frame,
+// update spends at most budget ms of gl calls per frame on the builds in flight and the
+// new ones, one step runs even over budget. adding a shader again before its build
+// started replaces its sources
+class ShaderWarmup {
+public:
+    
+    void add(AsyncShader &shader,const string &vertex,const string &fragment);
+    void update(float budget=2);
+    bool isDone();
+    int getNumPending();
+    
+private:
+    
+    struct Job {
+        AsyncShader *shader;
+        string vertex;
+        string fragment;
+    };
+    
+    deque<Job> queue;
+    vector<AsyncShader *> building;
+};
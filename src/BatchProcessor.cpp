@@ -0,0 +1,324 @@
+//
+//  BatchProcessor.cpp
+//  depthBlur
+//
+//
+
+#include "BatchProcessor.h"
+
+// gray + alpha is read as two channels, expand it the way the target swizzle shows it
+template<typename T>
+static void setResult(ofPixels_<T> &result,const T *data,int width,int height,int channels) {
+    if (channels!=2) {
+        result.setFromPixels(data, width, height, channels==1 ? OF_IMAGE_GRAYSCALE : OF_IMAGE_COLOR_ALPHA);
+        return;
+    }
+    result.allocate(width, height, OF_IMAGE_COLOR_ALPHA);
+    T *pixels = result.getPixels();
+    for (int i=0;i<width*height;i++) {
+        pixels[i*4] = pixels[i*4+1] = pixels[i*4+2] = data[i*2];
+        pixels[i*4+3] = data[i*2+1];
+    }
+}
+
+void BatchProcessor::DecodeThread::threadedFunction() {
+    for (int i=0;i<files.size() && isThreadRunning();i++) {
+        
+        while (isThreadRunning()) {
+            lock();
+            bool full = queue.size()>=maxQueue;
+            unlock();
+            if (!full) {
+                break;
+            }
+            ofSleepMillis(1);
+        }
+        
+        BatchFrame *frame = new BatchFrame;
+        frame->index = i;
+        if (!ofLoadImage(frame->pixels, files[i])) {
+            ofLogError("BatchProcessor") << "could not load " << files[i] << ", skipped";
+            delete frame;
+            lock();
+            failed++;
+            unlock();
+            continue;
+        }
+        
+        lock();
+        queue.push_back(frame);
+        decoded++;
+        unlock();
+    }
+}
+
+void BatchProcessor::EncodeThread::threadedFunction() {
+    while (isThreadRunning()) {
+        lock();
+        BatchFrame *frame = queue.empty() ? NULL : queue.front();
+        unlock();
+        
+        if (!frame) {
+            ofSleepMillis(1);
+            continue;
+        }
+        
+        string path = directory + "/" + ofToString(frame->index, 5, '0') + ".png";
+        if (frame->wideResult.isAllocated()) {
+            ofSaveImage(frame->wideResult, path);
+        } else {
+            ofSaveImage(frame->result, path);
+        }
+        
+        lock();
+        queue.pop_front();
+        written++;
+        unlock();
+        
+        delete frame;
+    }
+}
+
+BatchProcessor::BatchProcessor() {
+    chain = NULL;
+    input = 0;
+    numFrames = 0;
+    numBuffers = 0;
+    startTime = endTime = 0;
+    samples = 0;
+}
+
+BatchProcessor::~BatchProcessor() {
+    stop();
+}
+
+void BatchProcessor::setup(ShaderChain &chain,int input,int output,const vector<string> &files,string directory,int numBuffers) {
+    stop();
+    
+    this->chain = &chain;
+    this->input = input;
+    this->output = output;
+    
+    ofTexture &texture = chain.getTexture(output);
+    width = texture.getWidth();
+    height = texture.getHeight();
+    numFrames = files.size();
+    
+    ShaderFormat format = chain.getFormat(output);
+    channels = getFormatChannels(format);
+    readbackFormat = channels==1 ? GL_RED : channels==2 ? GL_RG : GL_RGBA;
+    readbackType = format==SHADER_FORMAT_R16F || format==SHADER_FORMAT_RG16F ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+    int bytes = width*height*channels*(readbackType==GL_UNSIGNED_SHORT ? 2 : 1);
+    
+    decoder.files = files;
+    decoder.maxQueue = 2*numBuffers;
+    decoder.decoded = 0;
+    decoder.failed = 0;
+    encoder.directory = directory;
+    encoder.written = 0;
+    
+    this->numBuffers = numBuffers;
+    readbacks.resize(numBuffers);
+    for (vector<Readback>::iterator iter=readbacks.begin();iter!=readbacks.end();iter++) {
+        glGenBuffers(1, &iter->pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, iter->pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+        iter->fence = 0;
+        iter->frame = NULL;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    head = 0;
+    inFlight = 0;
+    
+    samples = 0;
+    decodeQueueSum = readbackQueueSum = encodeQueueSum = 0;
+    decodeQueueMax = encodeQueueMax = 0;
+}
+
+void BatchProcessor::start() {
+    startTime = ofGetElapsedTimeMicros();
+    endTime = 0;
+    decoder.startThread(true, false);
+    encoder.startThread(true, false);
+}
+
+void BatchProcessor::stop() {
+    if (decoder.isThreadRunning()) {
+        decoder.waitForThread(true);
+    }
+    if (encoder.isThreadRunning()) {
+        encoder.waitForThread(true);
+    }
+    
+    for (deque<BatchFrame *>::iterator iter=decoder.queue.begin();iter!=decoder.queue.end();iter++) {
+        delete *iter;
+    }
+    decoder.queue.clear();
+    for (deque<BatchFrame *>::iterator iter=encoder.queue.begin();iter!=encoder.queue.end();iter++) {
+        delete *iter;
+    }
+    encoder.queue.clear();
+    
+    for (vector<Readback>::iterator iter=readbacks.begin();iter!=readbacks.end();iter++) {
+        if (iter->fence) {
+            glDeleteSync(iter->fence);
+        }
+        delete iter->frame;
+        glDeleteBuffers(1, &iter->pbo);
+    }
+    readbacks.clear();
+}
+
+bool BatchProcessor::update() {
+    if (readbacks.empty() || isDone()) {
+        return false;
+    }
+    
+    sampleQueues();
+    
+    // hand finished readbacks to the encoder, only block when the ring is full
+    while (inFlight) {
+        Readback &oldest = readbacks[(head-inFlight+numBuffers)%numBuffers];
+        bool full = inFlight==numBuffers;
+        if (!full && glClientWaitSync(oldest.fence, 0, 0)==GL_TIMEOUT_EXPIRED) {
+            break;
+        }
+        retire(oldest);
+        inFlight--;
+    }
+    
+    decoder.lock();
+    BatchFrame *frame = decoder.queue.empty() ? NULL : decoder.queue.front();
+    if (frame) {
+        decoder.queue.pop_front();
+    }
+    decoder.unlock();
+    
+    if (frame) {
+        upload(frame);
+    }
+    
+    if (isDone()) {
+        endTime = ofGetElapsedTimeMicros();
+        stop();
+        return false;
+    }
+    return true;
+}
+
+void BatchProcessor::upload(BatchFrame *frame) {
+    chain->getTexture(input).loadData(frame->pixels);
+    chain->invalidate(input);
+    chain->update();
+    
+    Readback &readback = readbacks[head];
+    ofTextureData &data = chain->getTexture(output).getTextureData();
+    
+    GLint alignment;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    glBindTexture(data.textureTarget, data.textureID);
+    glGetTexImage(data.textureTarget, 0, readbackFormat, readbackType, 0);
+    glBindTexture(data.textureTarget, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, alignment);
+    
+    // flushed so the fence polled with a zero timeout in update can ever signal
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    readback.frame = frame;
+    
+    head = (head+1)%numBuffers;
+    inFlight++;
+}
+
+void BatchProcessor::retire(Readback &readback) {
+    glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(readback.fence);
+    readback.fence = 0;
+    
+    BatchFrame *frame = readback.frame;
+    readback.frame = NULL;
+    
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    void *data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (data) {
+        if (readbackType==GL_UNSIGNED_SHORT) {
+            setResult(frame->wideResult, (unsigned short *)data, width, height, channels);
+        } else {
+            setResult(frame->result, (unsigned char *)data, width, height, channels);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    frame->pixels.clear();
+    
+    encoder.lock();
+    encoder.queue.push_back(frame);
+    encoder.unlock();
+}
+
+void BatchProcessor::sampleQueues() {
+    decoder.lock();
+    int decodeQueue = decoder.queue.size();
+    decoder.unlock();
+    
+    encoder.lock();
+    int encodeQueue = encoder.queue.size();
+    encoder.unlock();
+    
+    samples++;
+    decodeQueueSum+=decodeQueue;
+    readbackQueueSum+=inFlight;
+    encodeQueueSum+=encodeQueue;
+    decodeQueueMax = max(decodeQueueMax,decodeQueue);
+    encodeQueueMax = max(encodeQueueMax,encodeQueue);
+}
+
+bool BatchProcessor::isDone() {
+    return getFramesWritten()+getFramesFailed()==numFrames;
+}
+
+int BatchProcessor::getNumFrames() {
+    return numFrames;
+}
+
+int BatchProcessor::getFramesWritten() {
+    encoder.lock();
+    int written = encoder.written;
+    encoder.unlock();
+    return written;
+}
+
+int BatchProcessor::getFramesFailed() {
+    decoder.lock();
+    int failed = decoder.failed;
+    decoder.unlock();
+    return failed;
+}
+
+float BatchProcessor::getFrameRate() {
+    unsigned long long now = endTime ? endTime : ofGetElapsedTimeMicros();
+    if (now<=startTime) {
+        return 0;
+    }
+    return getFramesWritten()*1000000.0/(now-startTime);
+}
+
+string BatchProcessor::getReport() {
+    stringstream report;
+    report << "frames: " << getFramesWritten() << "/" << numFrames << ", " << getFrameRate() << " fps";
+    if (getFramesFailed()) {
+        report << ", " << getFramesFailed() << " failed to load";
+    }
+    report << endl;
+    if (samples) {
+        report << "queue depth (avg/max): decode " << decodeQueueSum/samples << "/" << decodeQueueMax;
+        report << ", readback " << readbackQueueSum/samples << "/" << numBuffers;
+        report << ", encode " << encodeQueueSum/samples << "/" << encodeQueueMax << endl;
+    }
+    return report.str();
+}
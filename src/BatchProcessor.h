@@ -0,0 +1,97 @@
+//
+//  BatchProcessor.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "ShaderChain.h"
+
+struct BatchFrame {
+    int index;
+    ofShortPixels pixels;
+    ofPixels result;
+    ofShortPixels wideResult; // 16 bit formats
+};
+
+// renders a sequence of image files through a shader chain and writes the result.
+// decoding and encoding run on their own threads, readback goes through a ring of
+// pixel buffer objects so the gpu is never waited on while it still has work queued
+class BatchProcessor {
+public:
+    
+    BatchProcessor();
+    ~BatchProcessor();
+    
+    // input is the chain input the frames are uploaded to, output the pass to save.
+    // 8 bit formats are saved as 8 bit images, 16F formats as 16 bit ones
+    void setup(ShaderChain &chain,int input,int output,const vector<string> &files,string directory,int numBuffers=3);
+    void start();
+    void stop();
+    
+    bool update(); // call from the gl thread until it returns false
+    bool isDone();
+    
+    int getNumFrames();
+    int getFramesWritten();
+    int getFramesFailed(); // files that could not be loaded, skipped
+    float getFrameRate();
+    string getReport();
+    
+private:
+    
+    class DecodeThread : public ofThread {
+    public:
+        void threadedFunction();
+        vector<string> files;
+        deque<BatchFrame *> queue;
+        int maxQueue;
+        int decoded;
+        int failed;
+    };
+    
+    class EncodeThread : public ofThread {
+    public:
+        void threadedFunction();
+        string directory;
+        deque<BatchFrame *> queue;
+        int written;
+    };
+    
+    struct Readback {
+        GLuint pbo;
+        GLsync fence;
+        BatchFrame *frame;
+    };
+    
+    void upload(BatchFrame *frame);
+    void retire(Readback &readback);
+    void sampleQueues();
+    
+    ShaderChain *chain;
+    int input;
+    int output;
+    GLenum readbackFormat;
+    GLenum readbackType;
+    int channels;
+    
+    DecodeThread decoder;
+    EncodeThread encoder;
+    
+    vector<Readback> readbacks;
+    int numBuffers;
+    int head;     // next readback to issue
+    int inFlight;
+    
+    int width;
+    int height;
+    int numFrames;
+    unsigned long long startTime;
+    unsigned long long endTime;
+    
+    int samples;
+    float decodeQueueSum,readbackQueueSum,encodeQueueSum;
+    int decodeQueueMax,encodeQueueMax;
+};
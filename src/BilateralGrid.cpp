@@ -0,0 +1,265 @@
+//
+//  BilateralGrid.cpp
+//  depthBlur
+//
+//
+
+#include "BilateralGrid.h"
+
+#define STRINGIFY(A) #A
+
+// the grid is stored as an atlas of depth slices side by side, each texel holds
+// (sum of depth, weight)
+
+BilateralGrid::BilateralGrid() {
+    fbo = 0;
+}
+
+BilateralGrid::~BilateralGrid() {
+    release();
+}
+
+void BilateralGrid::release() {
+    if (!fbo) {
+        return;
+    }
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteTextures(2, grid);
+    fbo = 0;
+}
+
+void BilateralGrid::setup(int width,int height,float spatial,float range,ShaderFormat format) {
+    release();
+    
+    this->width = width;
+    this->height = height;
+    this->spatial = spatial;
+    this->range = range;
+    this->format = format;
+    
+    // one extra cell so slicing can always interpolate with the next cell
+    gridWidth = (int)((width-1)/spatial)+2;
+    gridHeight = (int)((height-1)/spatial)+2;
+    gridDepth = (int)(1/range)+2;
+    
+    glGenFramebuffers(1, &fbo);
+    glGenVertexArrays(1, &vao);
+    for (int i=0;i<2;i++) {
+        grid[i] = createTargetTexture(gridWidth*gridDepth, gridHeight, GL_RG32F, GL_RG);
+        glBindTexture(GL_TEXTURE_2D, grid[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    allocateTarget(output, width, height, format);
+    
+    createShader(splatShader, STRINGIFY(
+                                        \n#version 150\n
+                                        uniform sampler2D depth;
+                                        uniform int width;
+                                        uniform float spatial;
+                                        uniform float range;
+                                        uniform ivec3 size;
+                                        flat out vec2 value;
+                                        
+                                        void main() {
+                                            ivec2 p = ivec2(gl_VertexID % width,gl_VertexID / width);
+                                            float d = texelFetch(depth,p,0).r;
+                                            ivec3 c = ivec3(floor(vec3(vec2(p)/spatial,d/range)+0.5));
+                                            vec2 atlas = vec2(size.x*size.z,size.y);
+                                            vec2 t = (vec2(c.z*size.x+c.x,c.y)+0.5)/atlas;
+                                            gl_Position = d > 0.0 ? vec4(t*2.0-1.0,0.0,1.0) : vec4(2.0,2.0,0.0,1.0);
+                                            value = vec2(d,1.0);
+                                        }
+                                        ), STRINGIFY(
+                                                     \n#version 150\n
+                                                     flat in vec2 value;
+                                                     out vec2 fragColor;
+                                                     
+                                                     void main(void) {
+                                                         fragColor = value;
+                                                     }
+                                                     ));
+    
+    createQuadShader(blurShader, STRINGIFY(
+                                           \n#version 150\n
+                                           uniform sampler2D grid;
+                                           uniform ivec3 size;
+                                           uniform ivec3 axis;
+                                           out vec2 fragColor;
+                                           
+                                           void main(void) {
+                                               const float w[5] = float[5](1.0,4.0,6.0,4.0,1.0);
+                                               ivec2 a = ivec2(gl_FragCoord.xy);
+                                               ivec3 c = ivec3(a.x % size.x,a.y,a.x / size.x);
+                                               vec2 sum = vec2(0.0);
+                                               for (int k = -2; k <= 2; k++) {
+                                                   ivec3 q = c+axis*k;
+                                                   if (all(greaterThanEqual(q,ivec3(0))) && all(lessThan(q,size))) {
+                                                       sum += w[k+2]*texelFetch(grid,ivec2(q.z*size.x+q.x,q.y),0).rg;
+                                                   }
+                                               }
+                                               fragColor = sum/16.0;
+                                           }
+                                           ));
+    
+    createQuadShader(sliceShader, STRINGIFY(
+                                            \n#version 150\n
+                                            uniform sampler2D depth;
+                                            uniform sampler2D grid;
+                                            uniform float spatial;
+                                            uniform float range;
+                                            uniform ivec3 size;
+                                            out vec4 fragColor;
+                                            
+                                            vec2 slice(vec2 g,float z) {
+                                                vec2 atlas = vec2(size.x*size.z,size.y);
+                                                return texture(grid,(vec2(z*size.x+g.x,g.y)+0.5)/atlas).rg;
+                                            }
+                                            
+                                            void main(void) {
+                                                ivec2 p = ivec2(gl_FragCoord.xy);
+                                                float d = texelFetch(depth,p,0).r;
+                                                vec2 g = vec2(p)/spatial;
+                                                float z = clamp(d/range,0.0,float(size.z-1));
+                                                float z0 = floor(z);
+                                                vec2 v = mix(slice(g,z0),slice(g,min(z0+1.0,float(size.z-1))),z-z0);
+                                                fragColor = vec4(vec3(v.y > 1e-4 ? v.x/v.y : d),1.0);
+                                            }
+                                            ));
+}
+
+void BilateralGrid::update(ofTexture &depth) {
+    if (!fbo) {
+        return;
+    }
+    
+    GLint previousFbo;
+    GLint previousViewport[4];
+    GLint previousVao;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVao);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLint blendSrcRgb,blendDstRgb,blendSrcAlpha,blendDstAlpha,blendEquationRgb,blendEquationAlpha;
+    glGetIntegerv(GL_BLEND_SRC_RGB, &blendSrcRgb);
+    glGetIntegerv(GL_BLEND_DST_RGB, &blendDstRgb);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &blendSrcAlpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &blendDstAlpha);
+    glGetIntegerv(GL_BLEND_EQUATION_RGB, &blendEquationRgb);
+    glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &blendEquationAlpha);
+    GLfloat clearColor[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    glBindVertexArray(vao);
+    
+    timer.begin();
+    
+    ofTextureData &depthData = depth.getTextureData();
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, gridWidth*gridDepth, gridHeight);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, grid[0], 0);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFunc(GL_ONE, GL_ONE);
+    splatShader.begin();
+    splatShader.setUniformTexture("depth", depthData.textureTarget, depthData.textureID, 0);
+    splatShader.setUniform1i("width", width);
+    splatShader.setUniform1f("spatial", spatial);
+    splatShader.setUniform1f("range", range);
+    splatShader.setUniform3i("size", gridWidth, gridHeight, gridDepth);
+    glDrawArrays(GL_POINTS, 0, width*height);
+    splatShader.end();
+    glDisable(GL_BLEND);
+    
+    const int axes[3][3] = {{1,0,0},{0,1,0},{0,0,1}};
+    int current = 0;
+    blurShader.begin();
+    blurShader.setUniform3i("size", gridWidth, gridHeight, gridDepth);
+    for (int i=0;i<3;i++) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, grid[1-current], 0);
+        blurShader.setUniformTexture("grid", GL_TEXTURE_2D, grid[current], 0);
+        blurShader.setUniform3i("axis", axes[i][0], axes[i][1], axes[i][2]);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        current = 1-current;
+    }
+    blurShader.end();
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    
+    output.begin();
+    sliceShader.begin();
+    sliceShader.setUniformTexture("depth", depthData.textureTarget, depthData.textureID, 0);
+    sliceShader.setUniformTexture("grid", GL_TEXTURE_2D, grid[current], 1);
+    sliceShader.setUniform1f("spatial", spatial);
+    sliceShader.setUniform1f("range", range);
+    sliceShader.setUniform3i("size", gridWidth, gridHeight, gridDepth);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    sliceShader.end();
+    output.end();
+    
+    timer.end();
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    glBindVertexArray(previousVao);
+    glBlendEquationSeparate(blendEquationRgb, blendEquationAlpha);
+    glBlendFuncSeparate(blendSrcRgb, blendDstRgb, blendSrcAlpha, blendDstAlpha);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+    if (blend) {
+        glEnable(GL_BLEND);
+    }
+}
+
+ofTexture &BilateralGrid::getTexture() {
+    return output.getTextureReference();
+}
+
+float BilateralGrid::getMillis() {
+    return timer.getMillis();
+}
+
+float BilateralGrid::getSpatial(int radius,double variance) {
+    // createCoefficients maps -radius..radius to [-1,1], so the deviation in pixels is
+    // radius*sqrt(variance). the 1 4 6 4 1 kernel has a deviation of 1 cell
+    return max(radius*sqrt(variance), 1.0);
+}
+
+string BilateralGrid::getComparison(ofTexture &depth,int radius,double variance) {
+    BilateralGrid matched;
+    matched.setup(width, height, getSpatial(radius, variance), range, format);
+    matched.update(depth);
+    float gridMillis = matched.getMillis();
+    
+    ofShader blur;
+    createDepthBlurShader(blur, radius, variance, SHADER_FORMAT_R16F);
+    
+    ofFbo fbo[2];
+    allocateTarget(fbo[0], width, height, SHADER_FORMAT_R16F);
+    allocateTarget(fbo[1], width, height, SHADER_FORMAT_R16F);
+    
+    GpuTimer blurTimer;
+    blurTimer.begin();
+    ofTexture *src = &depth;
+    for (int i=0;i<2;i++) {
+        fbo[i].begin();
+        blur.begin();
+        blur.setUniformTexture("tex0", *src, 0);
+        blur.setUniform2f("dir", i==0 ? 1.0/width : 0, i==1 ? 1.0/height : 0);
+        src->draw(0, 0, width, height);
+        blur.end();
+        fbo[i].end();
+        src = &fbo[i].getTextureReference();
+    }
+    blurTimer.end();
+    
+    stringstream report;
+    report << "bilateral grid " << matched.gridWidth << "x" << matched.gridHeight << "x" << matched.gridDepth << " spatial " << matched.spatial << ": " << gridMillis << " ms" << endl;
+    report << "depth blur radius " << radius << " variance " << variance << ": " << blurTimer.getMillis() << " ms" << endl;
+    return report.str();
+}
@@ -0,0 +1,61 @@
+//
+//  BilateralGrid.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "Shaders.h"
+#include "GpuTimer.h"
+
+// edge preserving depth smoothing: depth is splatted into a coarse (x,y,depth) grid,
+// the grid is blurred with a 5 tap kernel per axis and sliced back at full resolution.
+// the cost depends on the grid size, not on the spatial radius. zero depth is treated
+// as missing and filled from the grid
+class BilateralGrid {
+public:
+    
+    BilateralGrid();
+    ~BilateralGrid();
+    
+    // spatial is the cell size in pixels, range the cell size in normalized depth.
+    // the blur has a deviation of 1 cell, use getSpatial to match createDepthBlurShader
+    void setup(int width,int height,float spatial,float range,ShaderFormat format=SHADER_FORMAT_R16F);
+    
+    void update(ofTexture &depth);
+    
+    ofTexture &getTexture();
+    float getMillis();
+    
+    // cell size whose blur has the deviation of createDepthBlurShader(radius,variance)
+    static float getSpatial(int radius,double variance);
+    
+    // gpu time of a grid at getSpatial(radius,variance) against a horizontal and
+    // vertical createDepthBlurShader pass at the same radius and variance
+    string getComparison(ofTexture &depth,int radius,double variance);
+    
+private:
+    
+    void release();
+    
+    int width;
+    int height;
+    float spatial;
+    float range;
+    ShaderFormat format;
+    int gridWidth;
+    int gridHeight;
+    int gridDepth;
+    
+    GLuint fbo;
+    GLuint vao;
+    GLuint grid[2];
+    ofFbo output;
+    GpuTimer timer;
+    
+    ofShader splatShader;
+    ofShader blurShader;
+    ofShader sliceShader;
+};
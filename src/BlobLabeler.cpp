@@ -0,0 +1,524 @@
+//
+//  BlobLabeler.cpp
+//  depthBlur
+//
+//
+
+#include "BlobLabeler.h"
+
+#define STRINGIFY(A) #A
+
+// labels are the linear texel index + 1 stored in R32F, 0 is background
+
+BlobLabeler::BlobLabeler() {
+    fbo = 0;
+    iterations = 256;
+    numIterations = 0;
+    threshold = 0.5;
+    numLabels = 0;
+}
+
+BlobLabeler::~BlobLabeler() {
+    release();
+}
+
+void BlobLabeler::release() {
+    if (!fbo) {
+        return;
+    }
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteTextures(2, labels);
+    glDeleteTextures(1, &pyramid);
+    glDeleteTextures(1, &table);
+    glDeleteTextures(1, &slots);
+    glDeleteTextures(1, &sums);
+    glDeleteTextures(1, &bounds);
+    glDeleteQueries(BLOB_CONVERGENCE_QUERIES, queries);
+    fbo = 0;
+}
+
+void BlobLabeler::setup(int width,int height,int maxBlobs) {
+    release();
+    
+    this->width = width;
+    this->height = height;
+    this->maxBlobs = maxBlobs;
+    
+    // the count pyramid is square and power of two so every level halves exactly
+    int size = 1;
+    levels = 0;
+    while (size<max(width,height)) {
+        size*=2;
+        levels++;
+    }
+    
+    glGenFramebuffers(1, &fbo);
+    glGenVertexArrays(1, &vao);
+    labels[0] = createTargetTexture(width, height, GL_R32F, GL_RED);
+    labels[1] = createTargetTexture(width, height, GL_R32F, GL_RED);
+    pyramid = createTargetTexture(size, size, GL_R32F, GL_RED, levels+1);
+    table = createTargetTexture(maxBlobs, 1, GL_R32F, GL_RED);
+    slots = createTargetTexture(width, height, GL_R32F, GL_RED);
+    sums = createTargetTexture(maxBlobs, 1, GL_RGBA32F, GL_RGBA);
+    bounds = createTargetTexture(maxBlobs, 1, GL_RGBA32F, GL_RGBA);
+    glGenQueries(BLOB_CONVERGENCE_QUERIES, queries);
+    
+    createQuadShader(initShader, STRINGIFY(
+                                                         \n#version 150\n
+                                                         uniform sampler2D mask;
+                                                         uniform float threshold;
+                                                         uniform int width;
+                                                         out float label;
+                                                         
+                                                         void main(void) {
+                                                             ivec2 p = ivec2(gl_FragCoord.xy);
+                                                             label = texelFetch(mask,p,0).r > threshold ? float(p.y*width+p.x+1) : 0.0;
+                                                         }
+                                                         ));
+    
+    // min label of the 4 neighbourhood followed by a pointer jump through the parent
+    createQuadShader(propagateShader, STRINGIFY(
+                                                              \n#version 150\n
+                                                              uniform sampler2D labels;
+                                                              uniform int width;
+                                                              out float label;
+                                                              
+                                                              float neighbour(ivec2 p,float l) {
+                                                                  float n = texelFetch(labels,p,0).r;
+                                                                  return n > 0.0 ? min(l,n) : l;
+                                                              }
+                                                              
+                                                              void main(void) {
+                                                                  ivec2 p = ivec2(gl_FragCoord.xy);
+                                                                  ivec2 size = textureSize(labels,0);
+                                                                  float l = texelFetch(labels,p,0).r;
+                                                                  if (l == 0.0) {
+                                                                      label = 0.0;
+                                                                      return;
+                                                                  }
+                                                                  l = neighbour(ivec2(max(p.x-1,0),p.y),l);
+                                                                  l = neighbour(ivec2(min(p.x+1,size.x-1),p.y),l);
+                                                                  l = neighbour(ivec2(p.x,max(p.y-1,0)),l);
+                                                                  l = neighbour(ivec2(p.x,min(p.y+1,size.y-1)),l);
+                                                                  int parent = int(l)-1;
+                                                                  label = neighbour(ivec2(parent % width,parent / width),l);
+                                                              }
+                                                              ));
+    
+    // passes only where the last propagation changed the label, counted by an occlusion query
+    createQuadShader(changeShader, STRINGIFY(
+                                             \n#version 150\n
+                                             uniform sampler2D previous;
+                                             uniform sampler2D labels;
+                                             
+                                             void main(void) {
+                                                 ivec2 p = ivec2(gl_FragCoord.xy);
+                                                 if (texelFetch(previous,p,0).r == texelFetch(labels,p,0).r) {
+                                                     discard;
+                                                 }
+                                             }
+                                             ));
+    
+    // hooking: lowers the label of the texel a label points to with the smallest
+    // neighbouring label, blended with min so roots merge in a few iterations
+    createShader(hookShader, STRINGIFY(
+                                       \n#version 150\n
+                                       uniform sampler2D labels;
+                                       uniform int width;
+                                       uniform vec2 size;
+                                       flat out float label;
+                                       
+                                       float neighbour(ivec2 p,float l) {
+                                           float n = texelFetch(labels,p,0).r;
+                                           return n > 0.0 ? min(l,n) : l;
+                                       }
+                                       
+                                       void main() {
+                                           ivec2 p = ivec2(gl_VertexID % width,gl_VertexID / width);
+                                           ivec2 s = ivec2(size);
+                                           float l = texelFetch(labels,p,0).r;
+                                           float m = neighbour(ivec2(max(p.x-1,0),p.y),l);
+                                           m = neighbour(ivec2(min(p.x+1,s.x-1),p.y),m);
+                                           m = neighbour(ivec2(p.x,max(p.y-1,0)),m);
+                                           m = neighbour(ivec2(p.x,min(p.y+1,s.y-1)),m);
+                                           int i = int(l)-1;
+                                           vec2 q = (vec2(i % width,i / width)+0.5)/size;
+                                           gl_Position = l > 0.0 && m < l ? vec4(q*2.0-1.0,0.0,1.0) : vec4(2.0,2.0,0.0,1.0);
+                                           label = m;
+                                       }
+                                       ), STRINGIFY(
+                                                    \n#version 150\n
+                                                    flat in float label;
+                                                    out float fragColor;
+                                                    
+                                                    void main(void) {
+                                                        fragColor = label;
+                                                    }
+                                                    ));
+    
+    createQuadShader(rootShader, STRINGIFY(
+                                                         \n#version 150\n
+                                                         uniform sampler2D labels;
+                                                         uniform int width;
+                                                         out float count;
+                                                         
+                                                         void main(void) {
+                                                             ivec2 p = ivec2(gl_FragCoord.xy);
+                                                             ivec2 size = textureSize(labels,0);
+                                                             bool inside = p.x < size.x && p.y < size.y;
+                                                             float l = inside ? texelFetch(labels,p,0).r : 0.0;
+                                                             count = float(l == float(p.y*width+p.x+1));
+                                                         }
+                                                         ));
+    
+    createQuadShader(reduceShader, STRINGIFY(
+                                                           \n#version 150\n
+                                                           uniform sampler2D pyramid;
+                                                           out float count;
+                                                           
+                                                           void main(void) {
+                                                               ivec2 p = 2*ivec2(gl_FragCoord.xy);
+                                                               count = texelFetch(pyramid,p,0).r + texelFetch(pyramid,p+ivec2(1,0),0).r +
+                                                                       texelFetch(pyramid,p+ivec2(0,1),0).r + texelFetch(pyramid,p+ivec2(1,1),0).r;
+                                                           }
+                                                           ));
+    
+    // k-th root by walking down the count pyramid
+    createQuadShader(compactShader, STRINGIFY(
+                                                            \n#version 150\n
+                                                            uniform sampler2D pyramid;
+                                                            uniform int levels;
+                                                            uniform int width;
+                                                            out float label;
+                                                            
+                                                            void main(void) {
+                                                                float k = floor(gl_FragCoord.x);
+                                                                if (k >= texelFetch(pyramid,ivec2(0),levels).r) {
+                                                                    label = 0.0;
+                                                                    return;
+                                                                }
+                                                                ivec2 p = ivec2(0);
+                                                                for (int l = levels-1; l >= 0; l--) {
+                                                                    p *= 2;
+                                                                    float a = texelFetch(pyramid,p,l).r;
+                                                                    if (k >= a) {
+                                                                        k -= a;
+                                                                        a = texelFetch(pyramid,p+ivec2(1,0),l).r;
+                                                                        if (k < a) {
+                                                                            p.x += 1;
+                                                                        } else {
+                                                                            k -= a;
+                                                                            a = texelFetch(pyramid,p+ivec2(0,1),l).r;
+                                                                            if (k < a) {
+                                                                                p.y += 1;
+                                                                            } else {
+                                                                                k -= a;
+                                                                                p += ivec2(1,1);
+                                                                            }
+                                                                        }
+                                                                    }
+                                                                }
+                                                                label = float(p.y*width+p.x+1);
+                                                            }
+                                                            ));
+    
+    // marks each root texel with its slot in the blob table
+    createShader(slotShader, STRINGIFY(
+                                       \n#version 150\n
+                                       uniform sampler2D table;
+                                       uniform int width;
+                                       uniform vec2 size;
+                                       flat out float slot;
+                                       
+                                       void main() {
+                                           float l = texelFetch(table,ivec2(gl_VertexID,0),0).r;
+                                           int i = int(l)-1;
+                                           vec2 p = (vec2(i % width,i / width)+0.5)/size;
+                                           gl_Position = l > 0.0 ? vec4(p*2.0-1.0,0.0,1.0) : vec4(2.0,2.0,0.0,1.0);
+                                           slot = float(gl_VertexID+1);
+                                       }
+                                       ), STRINGIFY(
+                                                    \n#version 150\n
+                                                    flat in float slot;
+                                                    out float fragColor;
+                                                    
+                                                    void main(void) {
+                                                        fragColor = slot;
+                                                    }
+                                                    ));
+    
+    // scatters every labeled texel into its blob table entry, blended with add or max
+    createShader(statsShader, STRINGIFY(
+                                        \n#version 150\n
+                                        uniform sampler2D labels;
+                                        uniform sampler2D slots;
+                                        uniform int width;
+                                        uniform int maxBlobs;
+                                        uniform int bounds;
+                                        flat out vec4 value;
+                                        
+                                        void main() {
+                                            ivec2 p = ivec2(gl_VertexID % width,gl_VertexID / width);
+                                            float l = texelFetch(labels,p,0).r;
+                                            int i = int(l)-1;
+                                            float slot = l > 0.0 ? texelFetch(slots,ivec2(i % width,i / width),0).r : 0.0;
+                                            gl_Position = slot > 0.0 ? vec4((slot-0.5)/float(maxBlobs)*2.0-1.0,0.0,0.0,1.0) : vec4(2.0,2.0,0.0,1.0);
+                                            value = bounds == 1 ? vec4(p,-p) : vec4(1.0,p,0.0);
+                                        }
+                                        ), STRINGIFY(
+                                                     \n#version 150\n
+                                                     flat in vec4 value;
+                                                     out vec4 fragColor;
+                                                     
+                                                     void main(void) {
+                                                         fragColor = value;
+                                                     }
+                                                     ));
+}
+
+void BlobLabeler::setIterations(int iterations) {
+    this->iterations = iterations;
+}
+
+void BlobLabeler::setThreshold(float threshold) {
+    this->threshold = threshold;
+}
+
+void BlobLabeler::beginTarget(GLuint texture,int level,int width,int height) {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, level);
+    glViewport(0, 0, width, height);
+}
+
+void BlobLabeler::endTarget() {
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+}
+
+void BlobLabeler::drawQuad() {
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void BlobLabeler::update(ofTexture &mask) {
+    if (!fbo) {
+        return;
+    }
+    
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    GLint previousVao;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVao);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLint blendSrcRgb,blendDstRgb,blendSrcAlpha,blendDstAlpha,blendEquationRgb,blendEquationAlpha;
+    glGetIntegerv(GL_BLEND_SRC_RGB, &blendSrcRgb);
+    glGetIntegerv(GL_BLEND_DST_RGB, &blendDstRgb);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &blendSrcAlpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &blendDstAlpha);
+    glGetIntegerv(GL_BLEND_EQUATION_RGB, &blendEquationRgb);
+    glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &blendEquationAlpha);
+    GLfloat clearColor[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    glDisable(GL_BLEND);
+    
+    ofTextureData &maskData = mask.getTextureData();
+    
+    current = 0;
+    beginTarget(labels[current], 0, width, height);
+    initShader.begin();
+    initShader.setUniformTexture("mask", maskData.textureTarget, maskData.textureID, 0);
+    initShader.setUniform1f("threshold", threshold);
+    initShader.setUniform1i("width", width);
+    drawQuad();
+    initShader.end();
+    
+    int issued = 0;
+    int checked = 0;
+    bool converged = false;
+    for (numIterations=0;numIterations<iterations;numIterations++) {
+        // read the queries that are ready, never waiting for one
+        while (checked<issued && !converged) {
+            GLuint query = queries[checked%BLOB_CONVERGENCE_QUERIES];
+            GLint available;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                break;
+            }
+            GLint changed;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT, &changed);
+            converged = !changed;
+            checked++;
+        }
+        if (converged) {
+            break;
+        }
+        
+        beginTarget(labels[1-current], 0, width, height);
+        
+        propagateShader.begin();
+        propagateShader.setUniformTexture("labels", GL_TEXTURE_2D, labels[current], 0);
+        propagateShader.setUniform1i("width", width);
+        drawQuad();
+        propagateShader.end();
+        
+        glEnable(GL_BLEND);
+        glBlendEquation(GL_MIN);
+        hookShader.begin();
+        hookShader.setUniformTexture("labels", GL_TEXTURE_2D, labels[current], 0);
+        hookShader.setUniform1i("width", width);
+        hookShader.setUniform2f("size", width, height);
+        glDrawArrays(GL_POINTS, 0, width*height);
+        hookShader.end();
+        glBlendEquation(GL_FUNC_ADD);
+        glDisable(GL_BLEND);
+        
+        current = 1-current;
+        
+        // with every query in flight the pass goes unchecked, a later pass that changes
+        // nothing tells the same
+        if (issued-checked==BLOB_CONVERGENCE_QUERIES) {
+            continue;
+        }
+        
+        // slots is overwritten later, it only gives the query a target that is not sampled
+        beginTarget(slots, 0, width, height);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, queries[issued%BLOB_CONVERGENCE_QUERIES]);
+        changeShader.begin();
+        changeShader.setUniformTexture("previous", GL_TEXTURE_2D, labels[1-current], 0);
+        changeShader.setUniformTexture("labels", GL_TEXTURE_2D, labels[current], 1);
+        drawQuad();
+        changeShader.end();
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        issued++;
+    }
+    
+    int size = 1 << levels;
+    beginTarget(pyramid, 0, size, size);
+    rootShader.begin();
+    rootShader.setUniformTexture("labels", GL_TEXTURE_2D, labels[current], 0);
+    rootShader.setUniform1i("width", width);
+    drawQuad();
+    rootShader.end();
+    
+    // sample only the level below the one being written to avoid a feedback loop
+    reduceShader.begin();
+    for (int i=1;i<=levels;i++) {
+        glBindTexture(GL_TEXTURE_2D, pyramid);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, i-1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, i-1);
+        beginTarget(pyramid, i, size >> i, size >> i);
+        reduceShader.setUniformTexture("pyramid", GL_TEXTURE_2D, pyramid, 0);
+        drawQuad();
+    }
+    reduceShader.end();
+    endTarget();
+    glBindTexture(GL_TEXTURE_2D, pyramid);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels);
+    
+    beginTarget(table, 0, maxBlobs, 1);
+    compactShader.begin();
+    compactShader.setUniformTexture("pyramid", GL_TEXTURE_2D, pyramid, 0);
+    compactShader.setUniform1i("levels", levels);
+    compactShader.setUniform1i("width", width);
+    drawQuad();
+    compactShader.end();
+    
+    beginTarget(slots, 0, width, height);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    slotShader.begin();
+    slotShader.setUniformTexture("table", GL_TEXTURE_2D, table, 0);
+    slotShader.setUniform1i("width", width);
+    slotShader.setUniform2f("size", width, height);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_POINTS, 0, maxBlobs);
+    slotShader.end();
+    
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    statsShader.begin();
+    statsShader.setUniformTexture("labels", GL_TEXTURE_2D, labels[current], 0);
+    statsShader.setUniformTexture("slots", GL_TEXTURE_2D, slots, 1);
+    statsShader.setUniform1i("width", width);
+    statsShader.setUniform1i("maxBlobs", maxBlobs);
+    
+    beginTarget(sums, 0, maxBlobs, 1);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBlendEquation(GL_FUNC_ADD);
+    statsShader.setUniform1i("bounds", 0);
+    glDrawArrays(GL_POINTS, 0, width*height);
+    
+    beginTarget(bounds, 0, maxBlobs, 1);
+    glClearColor(-1e9, -1e9, -1e9, -1e9);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBlendEquation(GL_MAX);
+    statsShader.setUniform1i("bounds", 1);
+    glDrawArrays(GL_POINTS, 0, width*height);
+    statsShader.end();
+    
+    glBlendEquationSeparate(blendEquationRgb, blendEquationAlpha);
+    glBlendFuncSeparate(blendSrcRgb, blendDstRgb, blendSrcAlpha, blendDstAlpha);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+    if (blend) {
+        glEnable(GL_BLEND);
+    } else {
+        glDisable(GL_BLEND);
+    }
+    endTarget();
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    glBindVertexArray(previousVao);
+    
+    // the only readback: the label count and the blob table
+    float count;
+    glBindTexture(GL_TEXTURE_2D, pyramid);
+    glGetTexImage(GL_TEXTURE_2D, levels, GL_RED, GL_FLOAT, &count);
+    numLabels = count;
+    
+    vector<float> sumData(maxBlobs*4);
+    vector<float> boundsData(maxBlobs*4);
+    vector<float> tableData(maxBlobs);
+    glBindTexture(GL_TEXTURE_2D, sums);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, &sumData[0]);
+    glBindTexture(GL_TEXTURE_2D, bounds);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, &boundsData[0]);
+    glBindTexture(GL_TEXTURE_2D, table);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, &tableData[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    blobs.clear();
+    for (int i=0;i<min(numLabels,maxBlobs);i++) {
+        float *s = &sumData[i*4];
+        float *b = &boundsData[i*4];
+        Blob blob;
+        blob.label = tableData[i];
+        blob.area = s[0];
+        blob.centroid = ofVec2f(s[1]/s[0],s[2]/s[0]);
+        blob.boundingBox = ofRectangle(-b[2],-b[3],b[0]+b[2]+1,b[1]+b[3]+1);
+        blobs.push_back(blob);
+    }
+}
+
+const vector<Blob> &BlobLabeler::getBlobs() {
+    return blobs;
+}
+
+int BlobLabeler::getNumLabels() {
+    return numLabels;
+}
+
+int BlobLabeler::getNumIterations() {
+    return numIterations;
+}
+
+int BlobLabeler::getReadbackBytes() {
+    return sizeof(float)*(1+maxBlobs*9);
+}
+
+GLuint BlobLabeler::getLabelTexture() {
+    return labels[current];
+}
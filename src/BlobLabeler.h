@@ -0,0 +1,87 @@
+//
+//  BlobLabeler.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "Shaders.h"
+
+#define BLOB_CONVERGENCE_QUERIES 4
+
+struct Blob {
+    int label;
+    float area;
+    ofVec2f centroid;
+    ofRectangle boundingBox;
+};
+
+// connected component labeling of a binary mask on the gpu, only the blob table
+// (maxBlobs texels of area, centroid and bounding box) is read back.
+// coordinates are texel coordinates of the mask texture
+class BlobLabeler {
+public:
+    
+    BlobLabeler();
+    ~BlobLabeler();
+    
+    void setup(int width,int height,int maxBlobs=16);
+    // upper bound on the label propagation passes, they stop at the first one that changes no
+    // label. convergence is read from occlusion queries once their results are available, so
+    // the loop never waits on the gpu. with BLOB_CONVERGENCE_QUERIES in flight passes run
+    // unchecked, the passes past convergence change nothing
+    void setIterations(int iterations);
+    void setThreshold(float threshold);
+    
+    void update(ofTexture &mask);
+    
+    const vector<Blob> &getBlobs();
+    int getNumLabels(); // may exceed maxBlobs, extra blobs are dropped
+    int getNumIterations(); // propagation passes run by the last update
+    int getReadbackBytes();
+    GLuint getLabelTexture();
+    
+private:
+    
+    void release();
+    void beginTarget(GLuint texture,int level,int width,int height);
+    void endTarget();
+    void drawQuad();
+    
+    int width;
+    int height;
+    int maxBlobs;
+    int iterations;
+    int numIterations;
+    float threshold;
+    int levels;
+    
+    GLuint fbo;
+    GLuint vao;
+    GLuint labels[2];
+    GLuint pyramid;
+    GLuint table;
+    GLuint slots;
+    GLuint sums;
+    GLuint bounds;
+    GLuint queries[BLOB_CONVERGENCE_QUERIES];
+    int current;
+    
+    GLint previousFbo;
+    GLint previousViewport[4];
+    
+    ofShader initShader;
+    ofShader propagateShader;
+    ofShader hookShader;
+    ofShader changeShader;
+    ofShader rootShader;
+    ofShader reduceShader;
+    ofShader compactShader;
+    ofShader slotShader;
+    ofShader statsShader;
+    
+    int numLabels;
+    vector<Blob> blobs;
+};
@@ -0,0 +1,514 @@
+//
+//  CpuScheduler.cpp
+//  depthBlur
+//
+//
+
+#include "CpuScheduler.h"
+#include "ShaderReference.h"
+
+static CpuEffect createEffect(CpuEffectType type,float param0=0,float param1=0,float param2=0,int radius=0,int dx=0,int dy=0) {
+    CpuEffect effect;
+    effect.type = type;
+    effect.params[0] = param0;
+    effect.params[1] = param1;
+    effect.params[2] = param2;
+    effect.radius = radius;
+    effect.dx = dx;
+    effect.dy = dy;
+    return effect;
+}
+
+CpuEffect createDepthEffect(float minEdge,float maxEdge) {
+    return createEffect(CPU_EFFECT_DEPTH, minEdge, maxEdge);
+}
+
+CpuEffect createDepthMaskEffect(float minEdge,float maxEdge,float tolerance) {
+    return createEffect(CPU_EFFECT_DEPTH_MASK, minEdge, maxEdge, tolerance);
+}
+
+CpuEffect createDepthBackgroundSubtractionEffect(float tolerance) {
+    return createEffect(CPU_EFFECT_DEPTH_BACKGROUND_SUBTRACTION, tolerance);
+}
+
+CpuEffect createColor2GrayEffect() {
+    return createEffect(CPU_EFFECT_COLOR2GRAY);
+}
+
+CpuEffect createThresholdEffect(float edge0,float edge1) {
+    return createEffect(CPU_EFFECT_THRESHOLD, edge0, edge1);
+}
+
+CpuEffect createMaskingEffect() {
+    return createEffect(CPU_EFFECT_MASKING);
+}
+
+CpuEffect createInverseMaskingEffect() {
+    return createEffect(CPU_EFFECT_INVERSE_MASKING);
+}
+
+CpuEffect createScreenEffect() {
+    return createEffect(CPU_EFFECT_SCREEN);
+}
+
+CpuEffect createFastBlurEffect(int radius,double variance,int dx,int dy) {
+    return createEffect(CPU_EFFECT_FAST_BLUR, variance, 0, 0, radius, dx, dy);
+}
+
+CpuEffect createBlurEffect(int radius,double variance,int dx,int dy) {
+    return createEffect(CPU_EFFECT_BLUR, variance, 0, 0, radius, dx, dy);
+}
+
+CpuEffect createDepthBlurEffect(int radius,double variance,int dx,int dy) {
+    return createEffect(CPU_EFFECT_DEPTH_BLUR, variance, 0, 0, radius, dx, dy);
+}
+
+CpuEffect createDilationEffect() {
+    return createEffect(CPU_EFFECT_DILATION, 0, 0, 0, 1);
+}
+
+CpuEffect createKuwaharaEffect(int radius) {
+    return createEffect(CPU_EFFECT_KUWAHARA, 0, 0, 0, radius);
+}
+
+CpuEffect createBilateralGridEffect(float spatial,float range) {
+    return createEffect(CPU_EFFECT_BILATERAL_GRID, spatial, range);
+}
+
+static int getNumInputs(const CpuEffect &effect) {
+    switch (effect.type) {
+        case CPU_EFFECT_DEPTH_MASK:
+        case CPU_EFFECT_DEPTH_BACKGROUND_SUBTRACTION:
+        case CPU_EFFECT_MASKING:
+        case CPU_EFFECT_INVERSE_MASKING:
+        case CPU_EFFECT_SCREEN:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+// rows read above and below an output row, -1 when the whole frame is needed
+static int getFootprint(const CpuEffect &effect) {
+    switch (effect.type) {
+        case CPU_EFFECT_FAST_BLUR:
+        case CPU_EFFECT_BLUR:
+        case CPU_EFFECT_DEPTH_BLUR:
+            return effect.radius*abs(effect.dy);
+        case CPU_EFFECT_DILATION:
+        case CPU_EFFECT_KUWAHARA:
+            return effect.radius;
+        case CPU_EFFECT_BILATERAL_GRID:
+            return -1;
+        default:
+            return 0;
+    }
+}
+
+static void process(const CpuEffect &effect,const vector<const ofFloatPixels *> &src,ofFloatPixels &dst) {
+    const float *p = effect.params;
+    switch (effect.type) {
+        case CPU_EFFECT_DEPTH:
+            referenceDepth(*src[0], dst, p[0], p[1]);
+            break;
+        case CPU_EFFECT_DEPTH_MASK:
+            referenceDepthMask(*src[0], *src[1], dst, p[0], p[1], p[2]);
+            break;
+        case CPU_EFFECT_DEPTH_BACKGROUND_SUBTRACTION:
+            referenceDepthBackgroundSubtraction(*src[0], *src[1], dst, p[0]);
+            break;
+        case CPU_EFFECT_COLOR2GRAY:
+            referenceColor2Gray(*src[0], dst);
+            break;
+        case CPU_EFFECT_THRESHOLD:
+            referenceThreshold(*src[0], dst, p[0], p[1]);
+            break;
+        case CPU_EFFECT_MASKING:
+            referenceMasking(*src[0], *src[1], dst);
+            break;
+        case CPU_EFFECT_INVERSE_MASKING:
+            referenceInverseMasking(*src[0], *src[1], dst);
+            break;
+        case CPU_EFFECT_SCREEN:
+            referenceScreen(*src[0], *src[1], dst);
+            break;
+        case CPU_EFFECT_FAST_BLUR:
+            referenceFastBlur(*src[0], dst, effect.radius, p[0], effect.dx, effect.dy);
+            break;
+        case CPU_EFFECT_BLUR:
+            referenceBlur(*src[0], dst, effect.radius, p[0], effect.dx, effect.dy);
+            break;
+        case CPU_EFFECT_DEPTH_BLUR:
+            referenceDepthBlur(*src[0], dst, effect.radius, p[0], effect.dx, effect.dy);
+            break;
+        case CPU_EFFECT_DILATION:
+            referenceDilation(*src[0], dst);
+            break;
+        case CPU_EFFECT_KUWAHARA:
+            referenceKuwahara(*src[0], dst, effect.radius);
+            break;
+        case CPU_EFFECT_BILATERAL_GRID:
+            referenceBilateralGrid(*src[0], dst, p[0], p[1]);
+            break;
+    }
+}
+
+// dst has the channels of src
+static void copyRows(const ofFloatPixels &src,int srcRow,ofFloatPixels &dst,int dstRow,int rows) {
+    int stride = src.getWidth()*src.getNumChannels();
+    const float *first = src.getPixels()+srcRow*stride;
+    copy(first, first+rows*stride, dst.getPixels()+dstRow*stride);
+}
+
+void CpuScheduler::Worker::threadedFunction() {
+    while (isThreadRunning()) {
+        Task task;
+        if (!scheduler->popTask(index, task)) {
+            // checked under the mutex so a schedule or stop cannot slip in before the wait
+            scheduler->mutex.lock();
+            if (!scheduler->queued && isThreadRunning()) {
+                scheduler->work.wait(scheduler->mutex);
+            }
+            scheduler->mutex.unlock();
+            continue;
+        }
+        scheduler->runTask(task);
+        scheduler->finishTask(index, task);
+    }
+}
+
+CpuScheduler::CpuScheduler() {
+    numThreads = 0;
+    bandHeight = 32;
+    maxFrames = 2;
+    numInputs = 0;
+    queued = 0;
+    nextFrame = 0;
+    inFlight = 0;
+    nextWorker = 0;
+    frameLatencySum = 0;
+    framesDone = 0;
+    steals = 0;
+}
+
+CpuScheduler::~CpuScheduler() {
+    stop();
+    for (map<int,Frame *>::iterator iter=frames.begin();iter!=frames.end();iter++) {
+        delete iter->second;
+    }
+}
+
+void CpuScheduler::setup(int numThreads,int bandHeight,int maxFrames) {
+    stop();
+    this->numThreads = numThreads;
+    this->bandHeight = bandHeight;
+    this->maxFrames = maxFrames;
+    numInputs = 0;
+    effects.clear();
+    sources.clear();
+    dependents.clear();
+    latencySum.clear();
+    latencyCount.clear();
+    frameLatencySum = 0;
+    framesDone = 0;
+    steals = 0;
+}
+
+int CpuScheduler::addInput() {
+    numInputs++;
+    return -numInputs;
+}
+
+int CpuScheduler::addNode(CpuEffect effect,int source0,int source1) {
+    int node = effects.size();
+    effects.push_back(effect);
+    sources.push_back(vector<int>());
+    dependents.push_back(vector<int>());
+    latencySum.push_back(0);
+    latencyCount.push_back(0);
+    
+    int numSources = getNumInputs(effect);
+    for (int i=0;i<numSources;i++) {
+        int source = i ? source1 : source0;
+        sources[node].push_back(source);
+        if (source>=0) {
+            dependents[source].push_back(node);
+        }
+    }
+    return node;
+}
+
+void CpuScheduler::start() {
+    for (int i=0;i<numThreads;i++) {
+        ofPtr<Worker> worker(new Worker);
+        worker->scheduler = this;
+        worker->index = i;
+        workers.push_back(worker);
+        worker->startThread(true, false);
+    }
+}
+
+void CpuScheduler::stop() {
+    mutex.lock();
+    for (vector<ofPtr<Worker> >::iterator iter=workers.begin();iter!=workers.end();iter++) {
+        (*iter)->stopThread();
+    }
+    work.broadcast();
+    mutex.unlock();
+    for (vector<ofPtr<Worker> >::iterator iter=workers.begin();iter!=workers.end();iter++) {
+        (*iter)->waitForThread(true);
+    }
+    workers.clear();
+    queued = 0;
+}
+
+int CpuScheduler::submit(const vector<ofFloatPixels> &inputs) {
+    if (workers.empty()) {
+        ofLogError("CpuScheduler") << "submit before start()";
+        return -1;
+    }
+    if (inputs.empty() || inputs.size()<numInputs) {
+        ofLogError("CpuScheduler") << "submit with " << inputs.size() << " of " << numInputs << " inputs";
+        return -1;
+    }
+    for (int i=1;i<inputs.size();i++) {
+        if (inputs[i].getWidth()!=inputs[0].getWidth() || inputs[i].getHeight()!=inputs[0].getHeight()) {
+            ofLogError("CpuScheduler") << "input " << i << " is " << inputs[i].getWidth() << "x" << inputs[i].getHeight() << ", input 0 is " << inputs[0].getWidth() << "x" << inputs[0].getHeight();
+            return -1;
+        }
+    }
+    
+    while (true) {
+        mutex.lock();
+        bool full = inFlight>=maxFrames;
+        mutex.unlock();
+        if (!full) {
+            break;
+        }
+        ofSleepMillis(1);
+    }
+    
+    Frame *frame = new Frame;
+    frame->released = false;
+    frame->width = inputs[0].getWidth();
+    frame->height = inputs[0].getHeight();
+    frame->inputs = inputs;
+    frame->outputs.resize(effects.size());
+    frame->bands.assign(effects.size(), 0);
+    frame->ready.assign(effects.size(), 0);
+    frame->waiting.assign(effects.size(), 0);
+    for (int i=0;i<effects.size();i++) {
+        for (vector<int>::iterator iter=sources[i].begin();iter!=sources[i].end();iter++) {
+            frame->waiting[i] += *iter>=0;
+        }
+    }
+    frame->remaining = effects.size();
+    frame->start = ofGetElapsedTimeMicros();
+    
+    mutex.lock();
+    int id = nextFrame++;
+    frame->id = id;
+    frames[id] = frame;
+    inFlight++;
+    for (int i=0;i<effects.size();i++) {
+        if (!frame->waiting[i]) {
+            schedule(nextWorker, frame, i);
+            nextWorker = (nextWorker+1)%workers.size();
+        }
+    }
+    mutex.unlock();
+    
+    return id;
+}
+
+bool CpuScheduler::isDone(int frame) {
+    mutex.lock();
+    map<int,Frame *>::iterator iter = frames.find(frame);
+    bool done = iter==frames.end() || !iter->second->remaining;
+    mutex.unlock();
+    return done;
+}
+
+void CpuScheduler::wait(int frame) {
+    while (!isDone(frame)) {
+        ofSleepMillis(1);
+    }
+}
+
+ofFloatPixels &CpuScheduler::getOutput(int frame,int node) {
+    // the map changes under submit and release on other threads, the frame itself stays until release
+    mutex.lock();
+    map<int,Frame *>::iterator iter = frames.find(frame);
+    Frame *found = iter!=frames.end() && !iter->second->released ? iter->second : NULL;
+    mutex.unlock();
+    if (!found || node<0 || node>=found->outputs.size()) {
+        ofLogError("CpuScheduler") << "no output " << node << " of frame " << frame;
+        static ofFloatPixels empty;
+        return empty;
+    }
+    return found->outputs[node];
+}
+
+void CpuScheduler::release(int frame) {
+    mutex.lock();
+    map<int,Frame *>::iterator iter = frames.find(frame);
+    if (iter!=frames.end()) {
+        // queued and running tasks still point at a frame that is not done
+        if (iter->second->remaining) {
+            iter->second->released = true;
+        } else {
+            delete iter->second;
+            frames.erase(iter);
+        }
+    }
+    mutex.unlock();
+}
+
+// the owner works on its newest task, thieves take the oldest one from the others
+bool CpuScheduler::popTask(int worker,Task &task) {
+    Worker &own = *workers[worker];
+    own.lock();
+    bool found = !own.tasks.empty();
+    if (found) {
+        task = own.tasks.back();
+        own.tasks.pop_back();
+    }
+    own.unlock();
+    if (found) {
+        mutex.lock();
+        queued--;
+        mutex.unlock();
+    }
+    
+    for (int i=1;i<workers.size() && !found;i++) {
+        Worker &victim = *workers[(worker+i)%workers.size()];
+        victim.lock();
+        found = !victim.tasks.empty();
+        if (found) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+        }
+        victim.unlock();
+        if (found) {
+            mutex.lock();
+            queued--;
+            steals++;
+            mutex.unlock();
+        }
+    }
+    return found;
+}
+
+const ofFloatPixels &CpuScheduler::getSource(Frame *frame,int source) {
+    return source<0 ? frame->inputs[-source-1] : frame->outputs[source];
+}
+
+void CpuScheduler::runTask(Task &task) {
+    Frame *frame = task.frame;
+    CpuEffect &effect = effects[task.node];
+    ofFloatPixels &dst = frame->outputs[task.node];
+    
+    vector<const ofFloatPixels *> src;
+    if (task.y0==0 && task.y1==frame->height) {
+        for (vector<int>::iterator iter=sources[task.node].begin();iter!=sources[task.node].end();iter++) {
+            src.push_back(&getSource(frame, *iter));
+        }
+        ofFloatPixels result;
+        process(effect, src, result);
+        copyRows(result, 0, dst, 0, frame->height);
+        return;
+    }
+    
+    // the band with the rows its footprint reads, edge clamping of the crop matches the frame
+    int footprint = getFootprint(effect);
+    int top = max(task.y0-footprint,0);
+    int bottom = min(task.y1+footprint,frame->height);
+    vector<ofFloatPixels> bands(sources[task.node].size());
+    for (int i=0;i<bands.size();i++) {
+        const ofFloatPixels &source = getSource(frame, sources[task.node][i]);
+        bands[i].allocate(frame->width, bottom-top, source.getNumChannels());
+        copyRows(source, top, bands[i], 0, bottom-top);
+        src.push_back(&bands[i]);
+    }
+    ofFloatPixels result;
+    process(effect, src, result);
+    copyRows(result, task.y0-top, dst, task.y0, task.y1-task.y0);
+}
+
+void CpuScheduler::finishTask(int worker,Task &task) {
+    Frame *frame = task.frame;
+    int node = task.node;
+    
+    mutex.lock();
+    if (!--frame->bands[node]) {
+        unsigned long long now = ofGetElapsedTimeMicros();
+        latencySum[node] += (now-frame->ready[node])/1000.0;
+        latencyCount[node]++;
+        
+        for (vector<int>::iterator iter=dependents[node].begin();iter!=dependents[node].end();iter++) {
+            if (!--frame->waiting[*iter]) {
+                schedule(worker, frame, *iter);
+            }
+        }
+        
+        if (!--frame->remaining) {
+            frameLatencySum += (now-frame->start)/1000.0;
+            framesDone++;
+            inFlight--;
+            if (frame->released) {
+                frames.erase(frame->id);
+                delete frame;
+            }
+        }
+    }
+    mutex.unlock();
+}
+
+// called with the mutex held, the bands go to one worker and are stolen by idle ones
+void CpuScheduler::schedule(int worker,Frame *frame,int node) {
+    int footprint = getFootprint(effects[node]);
+    int height = footprint<0 ? frame->height : bandHeight;
+    
+    frame->ready[node] = ofGetElapsedTimeMicros();
+    frame->outputs[node].allocate(frame->width, frame->height, 4);
+    frame->bands[node] = (frame->height+height-1)/height;
+    
+    Worker &target = *workers[worker];
+    target.lock();
+    for (int y=0;y<frame->height;y+=height) {
+        Task task;
+        task.frame = frame;
+        task.node = node;
+        task.y0 = y;
+        task.y1 = min(y+height,frame->height);
+        target.tasks.push_back(task);
+        queued++;
+    }
+    target.unlock();
+    work.broadcast();
+}
+
+float CpuScheduler::getLatency(int node) {
+    mutex.lock();
+    float latency = latencyCount[node] ? latencySum[node]/latencyCount[node] : 0;
+    mutex.unlock();
+    return latency;
+}
+
+float CpuScheduler::getFrameLatency() {
+    mutex.lock();
+    float latency = framesDone ? frameLatencySum/framesDone : 0;
+    mutex.unlock();
+    return latency;
+}
+
+string CpuScheduler::getReport() {
+    stringstream report;
+    for (int i=0;i<effects.size();i++) {
+        report << "node " << i << ": " << getLatency(i) << " ms" << endl;
+    }
+    mutex.lock();
+    report << "frames: " << framesDone << ", " << (framesDone ? frameLatencySum/framesDone : 0) << " ms latency, " << steals << " steals" << endl;
+    mutex.unlock();
+    return report.str();
+}
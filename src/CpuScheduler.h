@@ -0,0 +1,142 @@
+//
+//  CpuScheduler.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "Poco/Condition.h"
+
+enum CpuEffectType {
+    CPU_EFFECT_DEPTH,
+    CPU_EFFECT_DEPTH_MASK,
+    CPU_EFFECT_DEPTH_BACKGROUND_SUBTRACTION,
+    CPU_EFFECT_COLOR2GRAY,
+    CPU_EFFECT_THRESHOLD,
+    CPU_EFFECT_MASKING,
+    CPU_EFFECT_INVERSE_MASKING,
+    CPU_EFFECT_SCREEN,
+    CPU_EFFECT_FAST_BLUR,
+    CPU_EFFECT_BLUR,
+    CPU_EFFECT_DEPTH_BLUR,
+    CPU_EFFECT_DILATION,
+    CPU_EFFECT_KUWAHARA,
+    CPU_EFFECT_BILATERAL_GRID
+};
+
+// an effect of ShaderReference with its parameters, created like the matching shader
+struct CpuEffect {
+    CpuEffectType type;
+    float params[3];
+    int radius;
+    int dx;
+    int dy;
+};
+
+CpuEffect createDepthEffect(float minEdge,float maxEdge);
+CpuEffect createDepthMaskEffect(float minEdge,float maxEdge,float tolerance); // src, bg
+CpuEffect createDepthBackgroundSubtractionEffect(float tolerance); // src, bg
+CpuEffect createColor2GrayEffect();
+CpuEffect createThresholdEffect(float edge0,float edge1);
+CpuEffect createMaskingEffect(); // src, mask
+CpuEffect createInverseMaskingEffect(); // src, mask
+CpuEffect createScreenEffect(); // src0, src1
+CpuEffect createFastBlurEffect(int radius,double variance,int dx,int dy);
+CpuEffect createBlurEffect(int radius,double variance,int dx,int dy);
+CpuEffect createDepthBlurEffect(int radius,double variance,int dx,int dy);
+CpuEffect createDilationEffect();
+CpuEffect createKuwaharaEffect(int radius);
+CpuEffect createBilateralGridEffect(float spatial,float range);
+
+// runs a graph of cpu effects on a work stealing thread pool. every node is cut in bands
+// of rows (with the rows its footprint reads around them) so independent nodes and bands
+// of one node run in parallel, and up to maxFrames frames are in flight at once.
+// sources are numbered like ShaderChain, inputs negative and nodes from 0
+class CpuScheduler {
+public:
+    
+    CpuScheduler();
+    ~CpuScheduler();
+    
+    void setup(int numThreads=4,int bandHeight=32,int maxFrames=2);
+    
+    int addInput();
+    int addNode(CpuEffect effect,int source0,int source1=0); // source1 is used by two input effects
+    
+    void start();
+    void stop();
+    
+    // inputs of any channel count and the same size, blocks while maxFrames are in
+    // flight. -1 before start() or for missing or mismatched inputs
+    int submit(const vector<ofFloatPixels> &inputs);
+    bool isDone(int frame);
+    void wait(int frame);
+    ofFloatPixels &getOutput(int frame,int node); // valid until release(frame), complete once isDone
+    void release(int frame); // a frame still running is freed when its last task finishes
+    
+    float getLatency(int node); // average ms from a node being ready to its last band
+    float getFrameLatency(); // average ms from submit to the last node
+    string getReport();
+    
+private:
+    
+    struct Frame {
+        int id;
+        bool released;
+        int width;
+        int height;
+        vector<ofFloatPixels> inputs;
+        vector<ofFloatPixels> outputs;
+        vector<int> waiting; // unfinished sources per node
+        vector<int> bands; // unfinished bands per node
+        vector<unsigned long long> ready;
+        int remaining;
+        unsigned long long start;
+    };
+    
+    struct Task {
+        Frame *frame;
+        int node;
+        int y0;
+        int y1;
+    };
+    
+    class Worker : public ofThread {
+    public:
+        void threadedFunction();
+        CpuScheduler *scheduler;
+        int index;
+        deque<Task> tasks;
+    };
+    
+    bool popTask(int worker,Task &task);
+    void runTask(Task &task);
+    void finishTask(int worker,Task &task);
+    void schedule(int worker,Frame *frame,int node);
+    const ofFloatPixels &getSource(Frame *frame,int source);
+    
+    int numThreads;
+    int bandHeight;
+    int maxFrames;
+    int numInputs;
+    vector<CpuEffect> effects;
+    vector<vector<int> > sources;
+    vector<vector<int> > dependents;
+    
+    vector<ofPtr<Worker> > workers;
+    ofMutex mutex; // frames and statistics, taken before a worker lock
+    Poco::Condition work; // signaled with the mutex when tasks are queued or on stop
+    int queued; // tasks in the worker queues
+    map<int,Frame *> frames;
+    int nextFrame;
+    int inFlight;
+    int nextWorker;
+    
+    vector<double> latencySum;
+    vector<int> latencyCount;
+    double frameLatencySum;
+    int framesDone;
+    int steals;
+};
@@ -0,0 +1,326 @@
+//
+//  DepthStatistics.cpp
+//  depthBlur
+//
+//
+
+#include "DepthStatistics.h"
+
+#define STRINGIFY(A) #A
+
+DepthStatistics::DepthStatistics() {
+    fbo = 0;
+    depthTarget = 0;
+    low = 0;
+    high = 1;
+    margin = 0;
+}
+
+DepthStatistics::~DepthStatistics() {
+    release();
+}
+
+void DepthStatistics::release() {
+    if (!fbo) {
+        return;
+    }
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteTextures(levels.size(), &levels[0]);
+    levels.clear();
+    sizes.clear();
+    fbo = 0;
+}
+
+void DepthStatistics::setup(int width,int height,int bins) {
+    release();
+    
+    this->width = width;
+    this->height = height;
+    this->bins = bins;
+    
+    glGenFramebuffers(1, &fbo);
+    glGenVertexArrays(1, &vao);
+    depthTarget = 0;
+    
+    // each level halves rounding up until a single texel holds (min,max)
+    int w = width;
+    int h = height;
+    do {
+        w = (w+1)/2;
+        h = (h+1)/2;
+        levels.push_back(createTargetTexture(w, h, GL_RG32F, GL_RG));
+        sizes.push_back(ofVec2f(w,h));
+    } while (w>1 || h>1);
+    
+    // not rectangle textures whatever the arb setting, they are attached as GL_TEXTURE_2D
+    histogram.allocate(bins, 1, GL_R32F, false);
+    histogram.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+    edges.allocate(1, 1, GL_RG32F, false);
+    edges.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+    
+    createQuadShader(reduceShader, STRINGIFY(
+                                             \n#version 150\n
+                                             uniform sampler2D src;
+                                             out vec2 minMax;
+                                             
+                                             vec2 reduce(vec2 r,ivec2 p,ivec2 size) {
+                                                 if (p.x >= size.x || p.y >= size.y) {
+                                                     return r;
+                                                 }
+                                                 vec2 v = texelFetch(src,p,0).rg;
+                                                 return vec2(min(r.x,v.x),max(r.y,v.y));
+                                             }
+                                             
+                                             void main(void) {
+                                                 ivec2 p = 2*ivec2(gl_FragCoord.xy);
+                                                 ivec2 size = textureSize(src,0);
+                                                 vec2 r = vec2(1e9,-1e9);
+                                                 r = reduce(r,p,size);
+                                                 r = reduce(r,p+ivec2(1,0),size);
+                                                 r = reduce(r,p+ivec2(0,1),size);
+                                                 r = reduce(r,p+ivec2(1,1),size);
+                                                 minMax = r;
+                                             }
+                                             ));
+    
+    createQuadShader(edgesShader, STRINGIFY(
+                                            \n#version 150\n
+                                            uniform sampler2D minMax;
+                                            uniform sampler2D histogram;
+                                            uniform int bins;
+                                            uniform float low;
+                                            uniform float high;
+                                            uniform float margin;
+                                            out vec2 edges;
+                                            
+                                            void main(void) {
+                                                vec2 r = texelFetch(minMax,ivec2(0),0).rg;
+                                                if (r.x > r.y) {
+                                                    edges = vec2(0.0,1.0);
+                                                    return;
+                                                }
+                                                
+                                                if (low > 0.0 || high < 1.0) {
+                                                    float total = 0.0;
+                                                    for (int i = 0; i < bins; i++) {
+                                                        total += texelFetch(histogram,ivec2(i,0),0).r;
+                                                    }
+                                                    float sum = 0.0;
+                                                    bool lowFound = low <= 0.0;
+                                                    for (int i = 0; i < bins; i++) {
+                                                        sum += texelFetch(histogram,ivec2(i,0),0).r;
+                                                        if (!lowFound && sum >= low*total) {
+                                                            r.x = max(r.x,float(i)/float(bins));
+                                                            lowFound = true;
+                                                        }
+                                                        if (high < 1.0 && sum >= high*total) {
+                                                            r.y = min(r.y,float(i+1)/float(bins));
+                                                            break;
+                                                        }
+                                                    }
+                                                }
+                                                
+                                                edges = r + vec2(-margin,margin);
+                                            }
+                                            ));
+}
+
+// the shaders reading the input are built for its texture target on first use
+void DepthStatistics::createDepthShaders(GLenum target) {
+    depthTarget = target;
+    reduceDepthShader.unload();
+    histogramShader.unload();
+    
+    string fetch;
+    if (target==GL_TEXTURE_RECTANGLE) {
+        fetch = STRINGIFY(
+                          \n#version 150\n
+                          uniform sampler2DRect depth;
+                          
+                          float fetchDepth(ivec2 p) {
+                              return texelFetch(depth,p).r;
+                          }
+                          );
+    } else {
+        fetch = STRINGIFY(
+                          \n#version 150\n
+                          uniform sampler2D depth;
+                          
+                          float fetchDepth(ivec2 p) {
+                              return texelFetch(depth,p,0).r;
+                          }
+                          );
+    }
+    
+    createQuadShader(reduceDepthShader, fetch + STRINGIFY(
+                                                          uniform ivec2 size;
+                                                          out vec2 minMax;
+                                                          
+                                                          vec2 reduce(vec2 r,ivec2 p) {
+                                                              if (p.x >= size.x || p.y >= size.y) {
+                                                                  return r;
+                                                              }
+                                                              float d = fetchDepth(p);
+                                                              return d > 0.0 ? vec2(min(r.x,d),max(r.y,d)) : r;
+                                                          }
+                                                          
+                                                          void main(void) {
+                                                              ivec2 p = 2*ivec2(gl_FragCoord.xy);
+                                                              vec2 r = vec2(1e9,-1e9);
+                                                              r = reduce(r,p);
+                                                              r = reduce(r,p+ivec2(1,0));
+                                                              r = reduce(r,p+ivec2(0,1));
+                                                              r = reduce(r,p+ivec2(1,1));
+                                                              minMax = r;
+                                                          }
+                                                          ));
+    
+    createShader(histogramShader, fetch + STRINGIFY(
+                                                    uniform int width;
+                                                    uniform int bins;
+                                                    
+                                                    void main() {
+                                                        float d = fetchDepth(ivec2(gl_VertexID % width,gl_VertexID / width));
+                                                        float bin = min(floor(d*float(bins)),float(bins-1));
+                                                        gl_Position = d > 0.0 && d <= 1.0 ? vec4((bin+0.5)/float(bins)*2.0-1.0,0.0,0.0,1.0) : vec4(2.0,2.0,0.0,1.0);
+                                                    }
+                                                    ), STRINGIFY(
+                                                                 \n#version 150\n
+                                                                 out float count;
+                                                                 
+                                                                 void main(void) {
+                                                                     count = 1.0;
+                                                                 }
+                                                                 ));
+}
+
+void DepthStatistics::setPercentiles(float low,float high) {
+    this->low = low;
+    this->high = high;
+}
+
+void DepthStatistics::setMargin(float margin) {
+    this->margin = margin;
+}
+
+void DepthStatistics::beginTarget(GLuint texture,int width,int height) {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    glViewport(0, 0, width, height);
+}
+
+void DepthStatistics::update(ofTexture &depth) {
+    if (!fbo) {
+        return;
+    }
+    
+    GLint previousFbo;
+    GLint previousViewport[4];
+    GLint previousVao;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVao);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLint blendSrcRgb,blendDstRgb,blendSrcAlpha,blendDstAlpha,blendEquationRgb,blendEquationAlpha;
+    glGetIntegerv(GL_BLEND_SRC_RGB, &blendSrcRgb);
+    glGetIntegerv(GL_BLEND_DST_RGB, &blendDstRgb);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &blendSrcAlpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &blendDstAlpha);
+    glGetIntegerv(GL_BLEND_EQUATION_RGB, &blendEquationRgb);
+    glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &blendEquationAlpha);
+    GLfloat clearColor[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    glBindVertexArray(vao);
+    glDisable(GL_BLEND);
+    
+    ofTextureData &depthData = depth.getTextureData();
+    if (depthData.textureTarget!=depthTarget) {
+        createDepthShaders(depthData.textureTarget);
+    }
+    
+    beginTarget(levels[0], sizes[0].x, sizes[0].y);
+    reduceDepthShader.begin();
+    reduceDepthShader.setUniformTexture("depth", depthData.textureTarget, depthData.textureID, 0);
+    reduceDepthShader.setUniform2i("size", width, height);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    reduceDepthShader.end();
+    
+    reduceShader.begin();
+    for (int i=1;i<levels.size();i++) {
+        beginTarget(levels[i], sizes[i].x, sizes[i].y);
+        reduceShader.setUniformTexture("src", GL_TEXTURE_2D, levels[i-1], 0);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    reduceShader.end();
+    
+    beginTarget(histogram.getTextureData().textureID, bins, 1);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFunc(GL_ONE, GL_ONE);
+    histogramShader.begin();
+    histogramShader.setUniformTexture("depth", depthData.textureTarget, depthData.textureID, 0);
+    histogramShader.setUniform1i("width", width);
+    histogramShader.setUniform1i("bins", bins);
+    glDrawArrays(GL_POINTS, 0, width*height);
+    histogramShader.end();
+    glDisable(GL_BLEND);
+    
+    beginTarget(edges.getTextureData().textureID, 1, 1);
+    edgesShader.begin();
+    edgesShader.setUniformTexture("minMax", GL_TEXTURE_2D, levels.back(), 0);
+    edgesShader.setUniformTexture("histogram", histogram.getTextureData().textureTarget, histogram.getTextureData().textureID, 1);
+    edgesShader.setUniform1i("bins", bins);
+    edgesShader.setUniform1f("low", low);
+    edgesShader.setUniform1f("high", high);
+    edgesShader.setUniform1f("margin", margin);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    edgesShader.end();
+    
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    glBindVertexArray(previousVao);
+    glBlendEquationSeparate(blendEquationRgb, blendEquationAlpha);
+    glBlendFuncSeparate(blendSrcRgb, blendDstRgb, blendSrcAlpha, blendDstAlpha);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+    if (blend) {
+        glEnable(GL_BLEND);
+    }
+}
+
+ofTexture &DepthStatistics::getEdgesTexture() {
+    return edges;
+}
+
+ofTexture &DepthStatistics::getHistogramTexture() {
+    return histogram;
+}
+
+ofVec2f DepthStatistics::getMinMax() {
+    float minMax[2];
+    glBindTexture(GL_TEXTURE_2D, levels.back());
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_FLOAT, minMax);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return ofVec2f(minMax[0],minMax[1]);
+}
+
+ofVec2f DepthStatistics::getEdges() {
+    float data[2];
+    ofTextureData &textureData = edges.getTextureData();
+    glBindTexture(textureData.textureTarget, textureData.textureID);
+    glGetTexImage(textureData.textureTarget, 0, GL_RG, GL_FLOAT, data);
+    glBindTexture(textureData.textureTarget, 0);
+    return ofVec2f(data[0],data[1]);
+}
+
+vector<float> DepthStatistics::getHistogram() {
+    vector<float> data(bins);
+    ofTextureData &textureData = histogram.getTextureData();
+    glBindTexture(textureData.textureTarget, textureData.textureID);
+    glGetTexImage(textureData.textureTarget, 0, GL_RED, GL_FLOAT, &data[0]);
+    glBindTexture(textureData.textureTarget, 0);
+    return data;
+}
@@ -0,0 +1,62 @@
+//
+//  DepthStatistics.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "Shaders.h"
+
+// min/max and histogram of a normalized depth texture computed on the gpu, zero depth
+// (no reading) is ignored. the edges texture holds (minEdge,maxEdge) for the auto depth
+// shaders so the statistics never leave the gpu. the depth can be a 2d or rectangle texture
+class DepthStatistics {
+public:
+    
+    DepthStatistics();
+    ~DepthStatistics();
+    
+    void setup(int width,int height,int bins=256);
+    
+    // edges from histogram percentiles, 0 and 1 use the exact min and max
+    void setPercentiles(float low,float high);
+    void setMargin(float margin); // widens the edges on both sides
+    
+    void update(ofTexture &depth);
+    
+    ofTexture &getEdgesTexture();
+    ofTexture &getHistogramTexture();
+    
+    // these read back from the gpu
+    ofVec2f getMinMax();
+    ofVec2f getEdges();
+    vector<float> getHistogram();
+    
+private:
+    
+    void release();
+    void createDepthShaders(GLenum target);
+    void beginTarget(GLuint texture,int width,int height);
+    
+    int width;
+    int height;
+    int bins;
+    float low;
+    float high;
+    float margin;
+    
+    GLuint fbo;
+    GLuint vao;
+    vector<GLuint> levels;
+    vector<ofVec2f> sizes;
+    ofTexture histogram;
+    ofTexture edges;
+    GLenum depthTarget; // GL_TEXTURE_2D or GL_TEXTURE_RECTANGLE
+    
+    ofShader reduceDepthShader;
+    ofShader reduceShader;
+    ofShader histogramShader;
+    ofShader edgesShader;
+};
@@ -0,0 +1,243 @@
+//
+//  DistanceField.cpp
+//  depthBlur
+//
+//
+
+#include "DistanceField.h"
+
+#define STRINGIFY(A) #A
+
+// seeds are the texel coordinates of the nearest edge texel inside the mask (rg) and outside
+// it (ba), negative when unknown. texels measure to the nearest one across the edge, so
+// erosion by a radius mirrors dilation by it
+
+DistanceField::DistanceField() {
+    fbo = 0;
+    threshold = 0.5;
+    numPasses = 0;
+}
+
+DistanceField::~DistanceField() {
+    release();
+}
+
+void DistanceField::release() {
+    if (!fbo) {
+        return;
+    }
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteTextures(2, seeds);
+    fbo = 0;
+}
+
+void DistanceField::setup(int width,int height) {
+    release();
+    
+    this->width = width;
+    this->height = height;
+    
+    glGenFramebuffers(1, &fbo);
+    glGenVertexArrays(1, &vao);
+    seeds[0] = createTargetTexture(width, height, GL_RGBA32F, GL_RGBA);
+    seeds[1] = createTargetTexture(width, height, GL_RGBA32F, GL_RGBA);
+    distance.allocate(width, height, GL_R32F);
+    distance.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+    
+    createQuadShader(seedShader, STRINGIFY(
+                                           \n#version 150\n
+                                           uniform sampler2D mask;
+                                           uniform float threshold;
+                                           out vec4 seed;
+                                           
+                                           bool inside(ivec2 p) {
+                                               return texelFetch(mask,clamp(p,ivec2(0),textureSize(mask,0)-1),0).r > threshold;
+                                           }
+                                           
+                                           void main(void) {
+                                               ivec2 p = ivec2(gl_FragCoord.xy);
+                                               bool center = inside(p);
+                                               bool edge = center!=inside(p+ivec2(1,0)) || center!=inside(p-ivec2(1,0)) ||
+                                                           center!=inside(p+ivec2(0,1)) || center!=inside(p-ivec2(0,1));
+                                               seed = vec4(-1.0);
+                                               if (edge && center) {
+                                                   seed.rg = vec2(p);
+                                               } else if (edge) {
+                                                   seed.ba = vec2(p);
+                                               }
+                                           }
+                                           ));
+    
+    createQuadShader(floodShader, STRINGIFY(
+                                            \n#version 150\n
+                                            uniform sampler2D seeds;
+                                            uniform int step;
+                                            out vec4 seed;
+                                            
+                                            void main(void) {
+                                                ivec2 p = ivec2(gl_FragCoord.xy);
+                                                ivec2 size = textureSize(seeds,0);
+                                                seed = vec4(-1.0);
+                                                vec2 best = vec2(1e9);
+                                                for (int j = -1; j <= 1; j++) {
+                                                    for (int i = -1; i <= 1; i++) {
+                                                        ivec2 q = p+ivec2(i,j)*step;
+                                                        if (q.x < 0 || q.y < 0 || q.x >= size.x || q.y >= size.y) {
+                                                            continue;
+                                                        }
+                                                        vec4 s = texelFetch(seeds,q,0);
+                                                        float d = distance(vec2(p),s.rg);
+                                                        if (s.r >= 0.0 && d < best.x) {
+                                                            best.x = d;
+                                                            seed.rg = s.rg;
+                                                        }
+                                                        d = distance(vec2(p),s.ba);
+                                                        if (s.b >= 0.0 && d < best.y) {
+                                                            best.y = d;
+                                                            seed.ba = s.ba;
+                                                        }
+                                                    }
+                                                }
+                                            }
+                                            ));
+    
+    createQuadShader(resolveShader, STRINGIFY(
+                                              \n#version 150\n
+                                              uniform sampler2D seeds;
+                                              uniform sampler2D mask;
+                                              uniform float threshold;
+                                              out float dist;
+                                              
+                                              void main(void) {
+                                                  ivec2 p = ivec2(gl_FragCoord.xy);
+                                                  vec4 s = texelFetch(seeds,p,0);
+                                                  if (texelFetch(mask,p,0).r > threshold) {
+                                                      dist = s.b >= 0.0 ? -distance(vec2(p),s.ba) : -1e4;
+                                                  } else {
+                                                      dist = s.r >= 0.0 ? distance(vec2(p),s.rg) : 1e4;
+                                                  }
+                                              }
+                                              ));
+}
+
+void DistanceField::setThreshold(float threshold) {
+    this->threshold = threshold;
+}
+
+void DistanceField::drawTo(GLuint texture) {
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void DistanceField::update(ofTexture &mask) {
+    if (!fbo) {
+        return;
+    }
+    
+    GLint previousFbo;
+    GLint previousViewport[4];
+    GLint previousVao;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVao);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glBindVertexArray(vao);
+    glViewport(0, 0, width, height);
+    glDisable(GL_BLEND);
+    
+    timer.begin();
+    
+    ofTextureData &maskData = mask.getTextureData();
+    
+    seedShader.begin();
+    seedShader.setUniformTexture("mask", maskData.textureTarget, maskData.textureID, 0);
+    seedShader.setUniform1f("threshold", threshold);
+    drawTo(seeds[0]);
+    seedShader.end();
+    numPasses = 1;
+    
+    int step = 1;
+    while (step*2<max(width,height)) {
+        step*=2;
+    }
+    
+    // the extra step 1 pass at the end (1+JFA) fixes most of the flooding errors
+    int current = 0;
+    floodShader.begin();
+    for (;;step/=2) {
+        floodShader.setUniformTexture("seeds", GL_TEXTURE_2D, seeds[current], 0);
+        floodShader.setUniform1i("step", max(step,1));
+        drawTo(seeds[1-current]);
+        current = 1-current;
+        numPasses++;
+        if (step==0) {
+            break;
+        }
+    }
+    floodShader.end();
+    
+    resolveShader.begin();
+    resolveShader.setUniformTexture("seeds", GL_TEXTURE_2D, seeds[current], 0);
+    resolveShader.setUniformTexture("mask", maskData.textureTarget, maskData.textureID, 1);
+    resolveShader.setUniform1f("threshold", threshold);
+    drawTo(distance.getTextureData().textureID);
+    resolveShader.end();
+    numPasses++;
+    
+    timer.end();
+    
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    glBindVertexArray(previousVao);
+    if (blend) {
+        glEnable(GL_BLEND);
+    }
+}
+
+ofTexture &DistanceField::getTexture() {
+    return distance;
+}
+
+int DistanceField::getNumPasses() {
+    return numPasses;
+}
+
+float DistanceField::getMillis() {
+    return timer.getMillis();
+}
+
+string DistanceField::getComparison(ofTexture &mask,int thickness) {
+    update(mask);
+    float fieldMillis = getMillis();
+    
+    ofShader dilation;
+    createDilationShader(dilation);
+    
+    ofFbo fbo[2];
+    fbo[0].allocate(width, height, GL_RGBA);
+    fbo[1].allocate(width, height, GL_RGBA);
+    
+    GpuTimer dilationTimer;
+    dilationTimer.begin();
+    ofTexture *src = &mask;
+    for (int i=0;i<thickness;i++) {
+        ofFbo &dst = fbo[i%2];
+        dst.begin();
+        dilation.begin();
+        dilation.setUniformTexture("tex0", *src, 0);
+        src->draw(0, 0, width, height);
+        dilation.end();
+        dst.end();
+        src = &dst.getTextureReference();
+    }
+    dilationTimer.end();
+    
+    stringstream report;
+    report << "distance field: " << getNumPasses() << " passes, " << fieldMillis << " ms" << endl;
+    report << "dilation x" << thickness << ": " << thickness << " passes, " << dilationTimer.getMillis() << " ms" << endl;
+    return report.str();
+}
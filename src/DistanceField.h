@@ -0,0 +1,53 @@
+//
+//  DistanceField.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "Shaders.h"
+#include "GpuTimer.h"
+
+// signed distance in pixels to the nearest texel across the edge of a mask using jump
+// flooding, negative inside. takes log2(size)+3 passes whatever the distance, the mask
+// must match the field size
+class DistanceField {
+public:
+    
+    DistanceField();
+    ~DistanceField();
+    
+    void setup(int width,int height);
+    void setThreshold(float threshold);
+    
+    void update(ofTexture &mask);
+    
+    ofTexture &getTexture(); // R32F distance, bind as distTex in the distance shaders
+    int getNumPasses();
+    float getMillis(); // gpu time of the last update
+    
+    // passes and gpu time against createDilationShader repeated thickness times
+    string getComparison(ofTexture &mask,int thickness);
+    
+private:
+    
+    void release();
+    void drawTo(GLuint texture);
+    
+    int width;
+    int height;
+    float threshold;
+    int numPasses;
+    
+    GLuint fbo;
+    GLuint vao;
+    GLuint seeds[2];
+    ofTexture distance;
+    GpuTimer timer;
+    
+    ofShader seedShader;
+    ofShader floodShader;
+    ofShader resolveShader;
+};
@@ -0,0 +1,208 @@
+//
+//  FrameTracer.cpp
+//  depthBlur
+//
+//
+
+#include "FrameTracer.h"
+
+FrameTracer::FrameTracer() {
+    enabled = true;
+    numSpans = 0;
+    numFrames = 0;
+    gpuOffset = 0;
+}
+
+FrameTracer::~FrameTracer() {
+    release();
+}
+
+void FrameTracer::release() {
+    for (vector<TraceSpan>::iterator iter=spans.begin();iter!=spans.end();iter++) {
+        glDeleteQueries(2, iter->queries);
+    }
+    spans.clear();
+    frames.clear();
+}
+
+void FrameTracer::setup(int maxSpans,int maxFrames) {
+    release();
+    spans.resize(maxSpans);
+    for (vector<TraceSpan>::iterator iter=spans.begin();iter!=spans.end();iter++) {
+        glGenQueries(2, iter->queries);
+        iter->pending = false;
+    }
+    frames.resize(maxFrames);
+    numSpans = 0;
+    numFrames = 0;
+}
+
+void FrameTracer::setEnabled(bool enabled) {
+    this->enabled = enabled;
+}
+
+bool FrameTracer::isEnabled() {
+    return enabled;
+}
+
+void FrameTracer::beginFrame(unsigned long long capture) {
+    if (!enabled || frames.empty()) {
+        return;
+    }
+    
+    unsigned long long now = ofGetElapsedTimeMicros();
+    TraceFrame &frame = frames[numFrames%frames.size()];
+    frame.frame = numFrames;
+    frame.capture = capture ? capture : now;
+    frame.begin = now;
+    frame.end = 0;
+    
+    // the gpu clock has its own origin, match it to the cpu clock once per frame
+    GLint64 gpu;
+    glGetInteger64v(GL_TIMESTAMP, &gpu);
+    gpuOffset = (long long)ofGetElapsedTimeMicros()-gpu/1000;
+}
+
+void FrameTracer::endFrame() {
+    if (!enabled || frames.empty()) {
+        return;
+    }
+    frames[numFrames%frames.size()].end = ofGetElapsedTimeMicros();
+    numFrames++;
+    collect();
+}
+
+int FrameTracer::begin(const char *name,int index) {
+    if (!enabled || spans.empty()) {
+        return -1;
+    }
+    int id = numSpans++;
+    TraceSpan &span = spans[id%spans.size()];
+    span.name = name;
+    span.index = index;
+    span.frame = numFrames;
+    span.cpuBegin = ofGetElapsedTimeMicros();
+    span.cpuEnd = 0;
+    span.pending = true;
+    glQueryCounter(span.queries[0], GL_TIMESTAMP);
+    return id;
+}
+
+void FrameTracer::end(int id) {
+    // the ring may have wrapped over the span since it began
+    if (id<0 || id<numSpans-(int)spans.size()) {
+        return;
+    }
+    TraceSpan &span = spans[id%spans.size()];
+    glQueryCounter(span.queries[1], GL_TIMESTAMP);
+    span.cpuEnd = ofGetElapsedTimeMicros();
+}
+
+void FrameTracer::collect() {
+    for (vector<TraceSpan>::iterator iter=spans.begin();iter!=spans.end();iter++) {
+        if (!iter->pending || !iter->cpuEnd) {
+            continue;
+        }
+        GLint available;
+        glGetQueryObjectiv(iter->queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+        GLuint64 begin,end;
+        glGetQueryObjectui64v(iter->queries[0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(iter->queries[1], GL_QUERY_RESULT, &end);
+        iter->gpuBegin = begin/1000+gpuOffset;
+        iter->gpuEnd = end/1000+gpuOffset;
+        iter->pending = false;
+    }
+}
+
+vector<float> FrameTracer::getLatencies() {
+    vector<float> latencies;
+    int count = min(numFrames,(int)frames.size());
+    for (int i=0;i<count;i++) {
+        if (frames[i].end) {
+            latencies.push_back((frames[i].end-frames[i].capture)/1000.0);
+        }
+    }
+    return latencies;
+}
+
+float FrameTracer::getAverageLatency() {
+    vector<float> latencies = getLatencies();
+    if (latencies.empty()) {
+        return 0;
+    }
+    float sum = 0;
+    for (vector<float>::iterator iter=latencies.begin();iter!=latencies.end();iter++) {
+        sum += *iter;
+    }
+    return sum/latencies.size();
+}
+
+float FrameTracer::getMaxLatency() {
+    vector<float> latencies = getLatencies();
+    return latencies.empty() ? 0 : *max_element(latencies.begin(), latencies.end());
+}
+
+int FrameTracer::getNumFramesOver(float millis) {
+    vector<float> latencies = getLatencies();
+    int over = 0;
+    for (vector<float>::iterator iter=latencies.begin();iter!=latencies.end();iter++) {
+        over += *iter>millis;
+    }
+    return over;
+}
+
+static void writeEvent(stringstream &json,bool &first,string name,int tid,long long begin,long long end,int frame) {
+    json << (first ? "\n" : ",\n");
+    json << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid;
+    json << ",\"ts\":" << begin << ",\"dur\":" << max(end-begin,0LL) << ",\"args\":{\"frame\":" << frame << "}}";
+    first = false;
+}
+
+string FrameTracer::getChromeTrace() {
+    collect();
+    
+    stringstream json;
+    json << "{\"traceEvents\":[";
+    json << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"frames\"}},";
+    json << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"cpu\"}},";
+    json << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"gpu\"}}";
+    bool first = false;
+    
+    // frames from capture to present, the time before begin is sensor and queue latency
+    int count = min(numFrames,(int)frames.size());
+    for (int i=numFrames-count;i<numFrames;i++) {
+        TraceFrame &frame = frames[i%frames.size()];
+        if (!frame.end) {
+            continue;
+        }
+        writeEvent(json, first, "frame "+ofToString(frame.frame), 0, frame.capture, frame.end, frame.frame);
+    }
+    
+    count = min(numSpans,(int)spans.size());
+    for (int i=numSpans-count;i<numSpans;i++) {
+        TraceSpan &span = spans[i%spans.size()];
+        if (!span.cpuEnd) {
+            continue;
+        }
+        string name = span.index<0 ? string(span.name) : string(span.name)+" "+ofToString(span.index);
+        writeEvent(json, first, name, 1, span.cpuBegin, span.cpuEnd, span.frame);
+        if (!span.pending) {
+            writeEvent(json, first, name, 2, span.gpuBegin, span.gpuEnd, span.frame);
+        }
+    }
+    json << "\n]}\n";
+    return json.str();
+}
+
+bool FrameTracer::save(string path) {
+    ofstream file(ofToDataPath(path).c_str());
+    if (!file.is_open()) {
+        ofLogError("FrameTracer") << "could not write " << path;
+        return false;
+    }
+    file << getChromeTrace();
+    return true;
+}
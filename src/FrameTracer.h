@@ -0,0 +1,69 @@
+//
+//  FrameTracer.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+
+struct TraceSpan {
+    const char *name; // not copied, use literals
+    int index; // pass or -1
+    int frame;
+    unsigned long long cpuBegin;
+    unsigned long long cpuEnd;
+    GLuint queries[2];
+    long long gpuBegin; // micros on the cpu clock
+    long long gpuEnd;
+    bool pending;
+};
+
+struct TraceFrame {
+    int frame;
+    unsigned long long capture;
+    unsigned long long begin;
+    unsigned long long end;
+};
+
+// per frame spans from capture to present with cpu times and gpu timestamps. spans and
+// frames live in fixed rings that overwrite the oldest entries, gpu results are collected
+// once available so tracing never waits on the gpu and can stay enabled.
+// times are on the ofGetElapsedTimeMicros clock
+class FrameTracer {
+public:
+    
+    FrameTracer();
+    ~FrameTracer();
+    
+    void setup(int maxSpans=4096,int maxFrames=256);
+    void setEnabled(bool enabled);
+    bool isEnabled();
+    
+    void beginFrame(unsigned long long capture=0); // capture time of the sensor frame, 0 for now
+    void endFrame(); // once the frame is presented
+    
+    int begin(const char *name,int index=-1);
+    void end(int span);
+    
+    float getAverageLatency(); // ms from capture to present over the frames in the ring
+    float getMaxLatency();
+    int getNumFramesOver(float millis);
+    
+    string getChromeTrace(); // chrome://tracing and perfetto json
+    bool save(string path);
+    
+private:
+    
+    void release();
+    void collect();
+    vector<float> getLatencies();
+    
+    bool enabled;
+    vector<TraceSpan> spans;
+    vector<TraceFrame> frames;
+    int numSpans; // ever recorded, the ring holds the last spans.size()
+    int numFrames;
+    long long gpuOffset; // cpu micros minus gpu micros
+};
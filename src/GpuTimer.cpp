@@ -0,0 +1,53 @@
+//
+//  GpuTimer.cpp
+//  depthBlur
+//
+//
+
+#include "GpuTimer.h"
+
+GpuTimer::GpuTimer() {
+    queries[0] = 0;
+    pending = false;
+    millis = 0;
+}
+
+GpuTimer::~GpuTimer() {
+    if (queries[0]) {
+        glDeleteQueries(2, queries);
+    }
+}
+
+void GpuTimer::begin() {
+    if (!queries[0]) {
+        glGenQueries(2, queries);
+    }
+    glQueryCounter(queries[0], GL_TIMESTAMP);
+}
+
+void GpuTimer::end() {
+    glQueryCounter(queries[1], GL_TIMESTAMP);
+    pending = true;
+}
+
+bool GpuTimer::isReady() {
+    if (!pending) {
+        return true;
+    }
+    // the end counter completes after the begin counter
+    GLint available = 0;
+    glGetQueryObjectiv(queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    return available;
+}
+
+float GpuTimer::getMillis() {
+    if (pending) {
+        GLuint64 start = 0;
+        GLuint64 stop = 0;
+        glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &stop);
+        millis = (stop-start)/1000000.0;
+        pending = false;
+    }
+    return millis;
+}
@@ -0,0 +1,30 @@
+//
+//  GpuTimer.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+
+// gpu time of the commands between begin and end, from a pair of GL_TIMESTAMP counters.
+// unlike GL_TIME_ELAPSED these nest inside timers and queries of the caller
+class GpuTimer {
+public:
+    
+    GpuTimer();
+    ~GpuTimer();
+    
+    void begin();
+    void end();
+    
+    bool isReady();    // result available without stalling
+    float getMillis(); // waits for the result
+    
+private:
+    
+    GLuint queries[2];
+    bool pending;
+    float millis;
+};
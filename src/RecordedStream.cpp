@@ -0,0 +1,334 @@
+//
+//  RecordedStream.cpp
+//  depthBlur
+//
+//
+
+#include "RecordedStream.h"
+
+#ifndef TARGET_WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static const unsigned int STREAM_VERSION = 1;
+
+static unsigned long long getPadded(unsigned long long bytes) {
+    return (bytes+7)&~7ULL;
+}
+
+static unsigned long long getFrameBytes(const StreamHeader &header) {
+    return (unsigned long long)header.width*header.height*2+(unsigned long long)header.rgbWidth*header.rgbHeight*3;
+}
+
+StreamRecorder::StreamRecorder() {
+    offset = 0;
+}
+
+StreamRecorder::~StreamRecorder() {
+    close();
+}
+
+bool StreamRecorder::open(string path,int width,int height,int rgbWidth,int rgbHeight) {
+    close();
+    file.open(ofToDataPath(path).c_str(), ios::binary | ios::trunc);
+    if (!file.is_open()) {
+        ofLogError("StreamRecorder") << "could not write " << path;
+        return false;
+    }
+    
+    memcpy(header.magic, "DSTR", 4);
+    header.version = STREAM_VERSION;
+    header.width = width;
+    header.height = height;
+    header.rgbWidth = rgbWidth;
+    header.rgbHeight = rgbHeight;
+    file.write((const char *)&header, sizeof(header));
+    offset = sizeof(header);
+    offsets.clear();
+    return true;
+}
+
+void StreamRecorder::addFrame(const ofShortPixels &depth,const ofPixels *rgb,unsigned long long timestamp) {
+    if (!file.is_open()) {
+        return;
+    }
+    if (depth.getWidth()!=header.width || depth.getHeight()!=header.height || depth.getNumChannels()!=1) {
+        ofLogError("StreamRecorder") << "depth frame does not match " << header.width << "x" << header.height;
+        return;
+    }
+    
+    StreamChunk chunk;
+    memcpy(chunk.tag, "FRAM", 4);
+    chunk.size = getPadded(getFrameBytes(header));
+    chunk.timestamp = timestamp ? timestamp : ofGetElapsedTimeMicros();
+    
+    offsets.push_back(offset);
+    file.write((const char *)&chunk, sizeof(chunk));
+    file.write((const char *)depth.getPixels(), header.width*header.height*2);
+    
+    int rgbBytes = header.rgbWidth*header.rgbHeight*3;
+    if (rgbBytes) {
+        if (rgb && rgb->getWidth()==header.rgbWidth && rgb->getHeight()==header.rgbHeight && rgb->getNumChannels()==3) {
+            file.write((const char *)rgb->getPixels(), rgbBytes);
+        } else {
+            vector<char> black(rgbBytes, 0);
+            file.write(&black[0], rgbBytes);
+        }
+    }
+    
+    const char padding[8] = {0,0,0,0,0,0,0,0};
+    file.write(padding, chunk.size-getFrameBytes(header));
+    offset += sizeof(chunk)+chunk.size;
+}
+
+void StreamRecorder::close() {
+    if (!file.is_open()) {
+        return;
+    }
+    StreamChunk chunk;
+    memcpy(chunk.tag, "INDX", 4);
+    chunk.size = sizeof(unsigned int)+offsets.size()*sizeof(unsigned long long);
+    chunk.timestamp = 0;
+    unsigned int count = offsets.size();
+    file.write((const char *)&chunk, sizeof(chunk));
+    file.write((const char *)&count, sizeof(count));
+    if (count) {
+        file.write((const char *)&offsets[0], offsets.size()*sizeof(unsigned long long));
+    }
+    file.close();
+}
+
+bool StreamRecorder::isOpen() {
+    return file.is_open();
+}
+
+int StreamRecorder::getNumFrames() {
+    return offsets.size();
+}
+
+StreamPlayer::StreamPlayer() {
+    data = NULL;
+    size = 0;
+    frame = 0;
+    uploaded = -1;
+    playing = false;
+    realtime = true;
+    frameNew = false;
+    startTime = 0;
+    startFrame = 0;
+    framesPlayed = 0;
+}
+
+StreamPlayer::~StreamPlayer() {
+    close();
+}
+
+bool StreamPlayer::load(string path) {
+    close();
+    string fullPath = ofToDataPath(path);
+    
+#ifdef TARGET_WIN32
+    ifstream file(fullPath.c_str(), ios::binary);
+    if (!file.is_open()) {
+        ofLogError("StreamPlayer") << "could not read " << path;
+        return false;
+    }
+    buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    data = buffer.empty() ? NULL : &buffer[0];
+    size = buffer.size();
+#else
+    int fd = ::open(fullPath.c_str(), O_RDONLY);
+    if (fd<0) {
+        ofLogError("StreamPlayer") << "could not read " << path;
+        return false;
+    }
+    struct stat info;
+    fstat(fd, &info);
+    size = info.st_size;
+    void *mapping = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (mapping==MAP_FAILED) {
+        ofLogError("StreamPlayer") << "could not map " << path;
+        size = 0;
+        return false;
+    }
+    data = (unsigned char *)mapping;
+    madvise(data, size, MADV_SEQUENTIAL);
+#endif
+    
+    if (size<sizeof(StreamHeader) || memcmp(data, "DSTR", 4)) {
+        ofLogError("StreamPlayer") << path << " is not a recorded stream";
+        close();
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.version!=STREAM_VERSION) {
+        ofLogError("StreamPlayer") << path << " has version " << header.version;
+        close();
+        return false;
+    }
+    
+    if (!buildIndex()) {
+        close();
+        return false;
+    }
+    
+    depth.allocate(header.width, header.height, GL_R16);
+    depth.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+    if (header.rgbWidth) {
+        rgb.allocate(header.rgbWidth, header.rgbHeight, GL_RGB8);
+    }
+    frame = 0;
+    uploaded = -1;
+    return true;
+}
+
+// frames follow the header back to back, the index at the end is only a shortcut
+bool StreamPlayer::buildIndex() {
+    offsets.clear();
+    unsigned long long frameSize = sizeof(StreamChunk)+getPadded(getFrameBytes(header));
+    unsigned long long position = sizeof(StreamHeader);
+    while (position+sizeof(StreamChunk)<=size) {
+        const StreamChunk *chunk = (const StreamChunk *)(data+position);
+        if (memcmp(chunk->tag, "FRAM", 4) || position+frameSize>size) {
+            break;
+        }
+        offsets.push_back(position);
+        position += frameSize;
+    }
+    
+    if (position+sizeof(StreamChunk)<=size && !memcmp(data+position, "INDX", 4)) {
+        unsigned int count;
+        memcpy(&count, data+position+sizeof(StreamChunk), sizeof(count));
+        if (count!=offsets.size()) {
+            ofLogWarning("StreamPlayer") << "index lists " << count << " frames, found " << offsets.size();
+        }
+    } else {
+        ofLogWarning("StreamPlayer") << "no index, recording was interrupted after " << offsets.size() << " frames";
+    }
+    return !offsets.empty();
+}
+
+void StreamPlayer::close() {
+#ifdef TARGET_WIN32
+    buffer.clear();
+#else
+    if (data) {
+        munmap(data, size);
+    }
+#endif
+    data = NULL;
+    size = 0;
+    offsets.clear();
+    playing = false;
+}
+
+void StreamPlayer::play(bool realtime) {
+    this->realtime = realtime;
+    playing = true;
+    startTime = ofGetElapsedTimeMicros();
+    startFrame = frame;
+    framesPlayed = 0;
+    uploaded = -1;
+}
+
+void StreamPlayer::stop() {
+    playing = false;
+}
+
+void StreamPlayer::update() {
+    frameNew = false;
+    if (offsets.empty()) {
+        return;
+    }
+    
+    if (playing) {
+        if (realtime) {
+            // the last frame whose recorded time has passed
+            unsigned long long elapsed = ofGetElapsedTimeMicros()-startTime;
+            unsigned long long first = getTimestamp(startFrame);
+            while (frame+1<offsets.size() && getTimestamp(frame+1)-first<=elapsed) {
+                frame++;
+            }
+        } else if (uploaded>=0) {
+            frame = min(frame+1,(int)offsets.size()-1);
+        }
+    }
+    
+    if (frame!=uploaded) {
+        depth.loadData(getDepthData(frame), header.width, header.height, GL_RED);
+        if (header.rgbWidth) {
+            rgb.loadData(getRgbData(frame), header.rgbWidth, header.rgbHeight, GL_RGB);
+        }
+        uploaded = frame;
+        frameNew = true;
+        framesPlayed++;
+    }
+    
+    if (playing && frame+1==offsets.size()) {
+        playing = false;
+    }
+}
+
+bool StreamPlayer::isFrameNew() {
+    return frameNew;
+}
+
+bool StreamPlayer::isDone() {
+    return !playing && frame+1==offsets.size();
+}
+
+void StreamPlayer::setFrame(int frame) {
+    this->frame = ofClamp(frame, 0, offsets.size()-1);
+}
+
+int StreamPlayer::getFrame() {
+    return frame;
+}
+
+int StreamPlayer::getNumFrames() {
+    return offsets.size();
+}
+
+const StreamChunk *StreamPlayer::getChunk(int frame) {
+    return (const StreamChunk *)(data+offsets[frame]);
+}
+
+unsigned long long StreamPlayer::getTimestamp(int frame) {
+    return getChunk(frame)->timestamp;
+}
+
+float StreamPlayer::getFrameRate() {
+    unsigned long long elapsed = ofGetElapsedTimeMicros()-startTime;
+    return elapsed ? framesPlayed*1000000.0/elapsed : 0;
+}
+
+const unsigned short *StreamPlayer::getDepthData(int frame) {
+    return (const unsigned short *)(data+offsets[frame]+sizeof(StreamChunk));
+}
+
+const unsigned char *StreamPlayer::getRgbData(int frame) {
+    if (!header.rgbWidth) {
+        return NULL;
+    }
+    return data+offsets[frame]+sizeof(StreamChunk)+header.width*header.height*2;
+}
+
+ofTexture &StreamPlayer::getDepthTexture() {
+    return depth;
+}
+
+ofTexture &StreamPlayer::getRgbTexture() {
+    return rgb;
+}
+
+int StreamPlayer::getWidth() {
+    return header.width;
+}
+
+int StreamPlayer::getHeight() {
+    return header.height;
+}
@@ -0,0 +1,107 @@
+//
+//  RecordedStream.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+
+// chunked container of raw 16 bit depth and optional 8 bit rgb frames with timestamps:
+//   header: "DSTR" version width height rgbWidth rgbHeight (uint32, rgb 0x0 when absent)
+//   frame:  "FRAM" payload bytes (uint32) timestamp in micros (uint64), depth, rgb, padded to 8
+//   index:  "INDX" count (uint32), frame offsets (uint64), written on close
+// a file without an index (recording interrupted) is indexed by scanning its frames
+struct StreamHeader {
+    char magic[4];
+    unsigned int version;
+    unsigned int width;
+    unsigned int height;
+    unsigned int rgbWidth;
+    unsigned int rgbHeight;
+};
+
+struct StreamChunk {
+    char tag[4];
+    unsigned int size;
+    unsigned long long timestamp;
+};
+
+class StreamRecorder {
+public:
+    
+    StreamRecorder();
+    ~StreamRecorder();
+    
+    bool open(string path,int width,int height,int rgbWidth=0,int rgbHeight=0);
+    void addFrame(const ofShortPixels &depth,const ofPixels *rgb=NULL,unsigned long long timestamp=0); // 0 for now
+    void close();
+    
+    bool isOpen();
+    int getNumFrames();
+    
+private:
+    
+    ofstream file;
+    StreamHeader header;
+    vector<unsigned long long> offsets;
+    unsigned long long offset;
+};
+
+// frames are read straight from a memory mapping and uploaded without copies. realtime
+// playback follows the recorded timestamps, otherwise every update advances a frame
+class StreamPlayer {
+public:
+    
+    StreamPlayer();
+    ~StreamPlayer();
+    
+    bool load(string path);
+    void close();
+    
+    void play(bool realtime=true);
+    void stop();
+    void update(); // uploads the current frame when it changed
+    bool isFrameNew();
+    bool isDone();
+    
+    void setFrame(int frame);
+    int getFrame();
+    int getNumFrames();
+    unsigned long long getTimestamp(int frame); // as recorded
+    float getFrameRate(); // frames uploaded per second since play
+    
+    const unsigned short *getDepthData(int frame); // into the mapping
+    const unsigned char *getRgbData(int frame); // NULL without rgb
+    
+    ofTexture &getDepthTexture(); // R16, bind as tex0 of the depth shaders
+    ofTexture &getRgbTexture();
+    
+    int getWidth();
+    int getHeight();
+    
+private:
+    
+    bool buildIndex();
+    const StreamChunk *getChunk(int frame);
+    
+    unsigned char *data;
+    unsigned long long size;
+    StreamHeader header;
+    vector<unsigned long long> offsets;
+    
+    ofTexture depth;
+    ofTexture rgb;
+    int frame;
+    int uploaded;
+    bool playing;
+    bool realtime;
+    bool frameNew;
+    unsigned long long startTime;
+    int startFrame;
+    int framesPlayed;
+#ifdef TARGET_WIN32
+    vector<unsigned char> buffer;
+#endif
+};
@@ -0,0 +1,307 @@
+//
+//  ReducedResolution.cpp
+//  depthBlur
+//
+//
+
+#include "ReducedResolution.h"
+
+#define STRINGIFY(A) #A
+
+// the same quad as ShaderChain, pixels with texcoords 0..1
+static void setupQuad(ofMesh &quad,int width,int height) {
+    quad.clear();
+    quad.setMode(OF_PRIMITIVE_TRIANGLE_FAN);
+    quad.addVertex(ofVec3f(0,0));
+    quad.addTexCoord(ofVec2f(0,0));
+    quad.addVertex(ofVec3f(width,0));
+    quad.addTexCoord(ofVec2f(1,0));
+    quad.addVertex(ofVec3f(width,height));
+    quad.addTexCoord(ofVec2f(1,1));
+    quad.addVertex(ofVec3f(0,height));
+    quad.addTexCoord(ofVec2f(0,1));
+}
+
+// channels an internal format stores, the gray targets of allocateTarget keep 1 or 2
+static int getInternalChannels(GLint internal) {
+    switch (internal) {
+        case GL_R8:
+        case GL_R16:
+        case GL_R16F:
+        case GL_R32F:
+            return 1;
+        case GL_RG8:
+        case GL_RG16:
+        case GL_RG16F:
+        case GL_RG32F:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+ReducedResolution::ReducedResolution() {
+    effect = NULL;
+    inputFormat = 0;
+    inputChannels = 4;
+    factor = 2;
+    textureName = "tex0";
+    sigma = 0.1;
+}
+
+void ReducedResolution::setup(int width,int height,ofShader &effect,int factor,ShaderFormat format) {
+    this->width = width;
+    this->height = height;
+    this->effect = &effect;
+    this->factor = factor;
+    this->format = format;
+    
+    int w = (width+factor-1)/factor;
+    int h = (height+factor-1)/factor;
+    inputFormat = 0; // allocated by the first update, in the format of the input
+    allocateTarget(reducedGuide, w, h, SHADER_FORMAT_R16F);
+    allocateTarget(reduced, w, h, format);
+    allocateTarget(output, width, height, format);
+    setupQuad(reducedQuad, w, h);
+    setupQuad(quad, width, height);
+    
+    // mode 0 averages rgba, 1 the guide luma, 2 the guide red channel, 3 rgba of a gray and
+    // alpha input packed back into rg
+    createSimpleShader(downsampleShader, STRINGIFY(
+                                                   \n#version 150\n
+                                                   uniform sampler2D tex0;
+                                                   uniform int factor;
+                                                   uniform int mode;
+                                                   in vec2 texCoordVarying;
+                                                   out vec4 fragColor;
+                                                   
+                                                   void main(void) {
+                                                       ivec2 size = textureSize(tex0,0);
+                                                       ivec2 origin = ivec2(texCoordVarying*vec2(size)/float(factor))*factor;
+                                                       vec4 sum = vec4(0.0);
+                                                       int count = 0;
+                                                       for (int j = 0; j < factor; j++) {
+                                                           for (int i = 0; i < factor; i++) {
+                                                               ivec2 p = origin+ivec2(i,j);
+                                                               if (p.x < size.x && p.y < size.y) {
+                                                                   sum += texelFetch(tex0,p,0);
+                                                                   count++;
+                                                               }
+                                                           }
+                                                       }
+                                                       sum /= float(count);
+                                                       float guide = mode == 1 ? dot(sum.rgb,vec3(0.299,0.587,0.114)) : sum.r;
+                                                       fragColor = mode == 0 ? sum : mode == 3 ? vec4(sum.ra,0.0,1.0) : vec4(vec3(guide),1.0);
+                                                   }
+                                                   ));
+    
+    // the 2x2 reduced texels around the pixel, bilinear weights scaled by guide similarity
+    createSimpleShader(upsampleShader, STRINGIFY(
+                                                 \n#version 150\n
+                                                 uniform sampler2D reducedTex;
+                                                 uniform sampler2D reducedGuideTex;
+                                                 uniform sampler2D guideTex;
+                                                 uniform int mode;
+                                                 uniform float sigma;
+                                                 in vec2 texCoordVarying;
+                                                 out vec4 fragColor;
+                                                 
+                                                 void main(void) {
+                                                     ivec2 size = textureSize(reducedTex,0);
+                                                     vec2 p = texCoordVarying*vec2(size)-0.5;
+                                                     vec2 base = floor(p);
+                                                     vec2 f = p-base;
+                                                     vec4 c = texture(guideTex,texCoordVarying);
+                                                     float guide = mode == 1 ? dot(c.rgb,vec3(0.299,0.587,0.114)) : c.r;
+                                                     
+                                                     vec4 sum = vec4(0.0);
+                                                     float weights = 0.0;
+                                                     vec4 bilinear = vec4(0.0);
+                                                     for (int j = 0; j < 2; j++) {
+                                                         for (int i = 0; i < 2; i++) {
+                                                             ivec2 q = clamp(ivec2(base)+ivec2(i,j),ivec2(0),size-1);
+                                                             float spatial = (i == 0 ? 1.0-f.x : f.x)*(j == 0 ? 1.0-f.y : f.y);
+                                                             float d = guide-texelFetch(reducedGuideTex,q,0).r;
+                                                             float w = spatial*exp(-d*d/(2.0*sigma*sigma));
+                                                             vec4 v = texelFetch(reducedTex,q,0);
+                                                             sum += w*v;
+                                                             weights += w;
+                                                             bilinear += spatial*v;
+                                                         }
+                                                     }
+                                                     fragColor = weights > 1e-4 ? sum/weights : bilinear;
+                                                 }
+                                                 ));
+}
+
+void ReducedResolution::setTextureName(string name) {
+    textureName = name;
+}
+
+void ReducedResolution::setSigma(float sigma) {
+    this->sigma = sigma;
+}
+
+void ReducedResolution::setUniform(string name,float value) {
+    floats[name] = value;
+}
+
+void ReducedResolution::setUniform(string name,float x,float y) {
+    vecs[name] = ofVec2f(x,y);
+}
+
+void ReducedResolution::setUniform(string name,int value) {
+    ints[name] = value;
+}
+
+void ReducedResolution::setTexelUniform(string name,float value) {
+    texelFloats[name] = value;
+}
+
+void ReducedResolution::setTexelUniform(string name,float x,float y) {
+    texelVecs[name] = ofVec2f(x,y);
+}
+
+void ReducedResolution::setUniforms(float texelScale) {
+    for (map<string,float>::iterator iter=floats.begin();iter!=floats.end();iter++) {
+        effect->setUniform1f(iter->first, iter->second);
+    }
+    for (map<string,ofVec2f>::iterator iter=vecs.begin();iter!=vecs.end();iter++) {
+        effect->setUniform2f(iter->first, iter->second.x, iter->second.y);
+    }
+    for (map<string,int>::iterator iter=ints.begin();iter!=ints.end();iter++) {
+        effect->setUniform1i(iter->first, iter->second);
+    }
+    for (map<string,float>::iterator iter=texelFloats.begin();iter!=texelFloats.end();iter++) {
+        effect->setUniform1f(iter->first, iter->second*texelScale);
+    }
+    for (map<string,ofVec2f>::iterator iter=texelVecs.begin();iter!=texelVecs.end();iter++) {
+        effect->setUniform2f(iter->first, iter->second.x*texelScale, iter->second.y*texelScale);
+    }
+}
+
+void ReducedResolution::update(ofTexture &input,ofTexture *guide) {
+    if (!effect) {
+        return;
+    }
+    
+    // an 8 bit reduced input would band a 16 bit or float input before the effect sees it
+    ofTextureData &inputData = input.getTextureData();
+    if (inputData.glTypeInternal!=inputFormat) {
+        inputFormat = inputData.glTypeInternal;
+        inputChannels = getInternalChannels(inputFormat);
+        reducedInput.allocate(getReducedWidth(), getReducedHeight(), inputFormat);
+        if (inputChannels<4) {
+            // same swizzle as allocateTarget
+            GLint swizzle[4] = {GL_RED,GL_RED,GL_RED,inputChannels==2 ? GL_GREEN : GL_ONE};
+            ofTextureData &data = reducedInput.getTextureReference().getTextureData();
+            glBindTexture(data.textureTarget, data.textureID);
+            glTexParameteriv(data.textureTarget, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+            glBindTexture(data.textureTarget, 0);
+        }
+    }
+    
+    timer.begin();
+    
+    reducedInput.begin();
+    downsampleShader.begin();
+    downsampleShader.setUniformTexture("tex0", input, 0);
+    downsampleShader.setUniform1i("factor", factor);
+    downsampleShader.setUniform1i("mode", inputChannels==2 ? 3 : 0);
+    reducedQuad.draw();
+    downsampleShader.end();
+    reducedInput.end();
+    
+    reducedGuide.begin();
+    downsampleShader.begin();
+    downsampleShader.setUniformTexture("tex0", guide ? *guide : input, 0);
+    downsampleShader.setUniform1i("factor", factor);
+    downsampleShader.setUniform1i("mode", guide ? 2 : 1);
+    reducedQuad.draw();
+    downsampleShader.end();
+    reducedGuide.end();
+    
+    reduced.begin();
+    ofClear(0);
+    effect->begin();
+    effect->setUniformTexture(textureName, reducedInput.getTextureReference(), 0);
+    setUniforms(1);
+    reducedQuad.draw();
+    effect->end();
+    reduced.end();
+    
+    output.begin();
+    upsampleShader.begin();
+    upsampleShader.setUniformTexture("reducedTex", reduced.getTextureReference(), 0);
+    upsampleShader.setUniformTexture("reducedGuideTex", reducedGuide.getTextureReference(), 1);
+    upsampleShader.setUniformTexture("guideTex", guide ? *guide : input, 2);
+    upsampleShader.setUniform1i("mode", guide ? 2 : 1);
+    upsampleShader.setUniform1f("sigma", sigma);
+    quad.draw();
+    upsampleShader.end();
+    output.end();
+    
+    timer.end();
+}
+
+ofTexture &ReducedResolution::getTexture() {
+    return output.getTextureReference();
+}
+
+ofTexture &ReducedResolution::getReducedTexture() {
+    return reduced.getTextureReference();
+}
+
+int ReducedResolution::getReducedWidth() {
+    return (width+factor-1)/factor;
+}
+
+int ReducedResolution::getReducedHeight() {
+    return (height+factor-1)/factor;
+}
+
+float ReducedResolution::getMillis() {
+    return timer.getMillis();
+}
+
+string ReducedResolution::getComparison(ofTexture &input,ofTexture *guide) {
+    update(input, guide);
+    float reducedMillis = getMillis();
+    
+    ofFbo full;
+    allocateTarget(full, width, height, format);
+    GpuTimer fullTimer;
+    fullTimer.begin();
+    full.begin();
+    ofClear(0);
+    effect->begin();
+    effect->setUniformTexture(textureName, input, 0);
+    setUniforms(factor); // texel uniforms back in full resolution pixels
+    quad.draw();
+    effect->end();
+    full.end();
+    fullTimer.end();
+    float fullMillis = fullTimer.getMillis();
+    
+    ofFloatPixels expected,result;
+    full.getTextureReference().readToPixels(expected);
+    output.getTextureReference().readToPixels(result);
+    
+    double sum = 0;
+    double squares = 0;
+    float largest = 0;
+    for (int i=0;i<result.size();i++) {
+        float difference = fabs(result[i]-expected[i]);
+        sum += difference;
+        squares += difference*difference;
+        largest = max(largest,difference);
+    }
+    double mse = squares/result.size();
+    
+    stringstream report;
+    report << "full: " << fullMillis << " ms, 1/" << factor << ": " << reducedMillis << " ms";
+    report << " (" << (reducedMillis>0 ? fullMillis/reducedMillis : 0) << "x)" << endl;
+    report << "error: mean " << sum/result.size() << ", max " << largest;
+    report << ", psnr " << (mse>0 ? 10*log10(1/mse) : 99) << " db" << endl;
+    return report.str();
+}
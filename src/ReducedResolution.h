@@ -0,0 +1,72 @@
+//
+//  ReducedResolution.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "Shaders.h"
+#include "GpuTimer.h"
+
+// runs an effect at 1/factor resolution and upsamples it with a joint bilateral filter
+// guided by the full resolution input, or by the red channel of a separate guide (depth).
+// the input is box filtered into the effect texture (textureName), uniforms set here
+// are applied on every update. lengths in pixels (radii, offsets) go through setTexelUniform
+// in reduced pixels so the full resolution comparison can scale them by factor, lengths in
+// texcoords cover the same part of the image at both sizes and are plain uniforms
+class ReducedResolution {
+public:
+    
+    ReducedResolution();
+    
+    void setup(int width,int height,ofShader &effect,int factor=2,ShaderFormat format=SHADER_FORMAT_RGBA8);
+    void setTextureName(string name); // tex0 by default
+    void setSigma(float sigma); // guide difference where weights drop to 60%
+    void setUniform(string name,float value);
+    void setUniform(string name,float x,float y);
+    void setUniform(string name,int value);
+    void setTexelUniform(string name,float value);
+    void setTexelUniform(string name,float x,float y);
+    
+    void update(ofTexture &input,ofTexture *guide=NULL);
+    
+    ofTexture &getTexture();
+    ofTexture &getReducedTexture();
+    int getReducedWidth();
+    int getReducedHeight();
+    float getMillis(); // gpu time of the last update
+    
+    // gpu time and error against running the effect at full resolution with the same uniforms
+    string getComparison(ofTexture &input,ofTexture *guide=NULL);
+    
+private:
+    
+    void setUniforms(float texelScale);
+    
+    int width;
+    int height;
+    int factor;
+    ShaderFormat format;
+    GLint inputFormat; // of reducedInput, follows the input
+    int inputChannels;
+    string textureName;
+    float sigma;
+    map<string,float> floats;
+    map<string,ofVec2f> vecs;
+    map<string,int> ints;
+    map<string,float> texelFloats;
+    map<string,ofVec2f> texelVecs;
+    
+    ofShader *effect;
+    ofShader downsampleShader;
+    ofShader upsampleShader;
+    ofFbo reducedInput;
+    ofFbo reducedGuide;
+    ofFbo reduced;
+    ofFbo output;
+    ofMesh reducedQuad;
+    ofMesh quad;
+    GpuTimer timer;
+};
@@ -0,0 +1,340 @@
+//
+//  RegionOfInterest.cpp
+//  depthBlur
+//
+//
+
+#include "RegionOfInterest.h"
+
+#define STRINGIFY(A) #A
+
+RegionOfInterest::RegionOfInterest() {
+    fbo = 0;
+    fence = 0;
+    threshold = 0;
+    generation = 0;
+    numActiveTiles = 0;
+    activePixels = 0;
+}
+
+RegionOfInterest::~RegionOfInterest() {
+    release();
+}
+
+void RegionOfInterest::release() {
+    if (!fbo) {
+        return;
+    }
+    if (fence) {
+        glDeleteSync(fence);
+        fence = 0;
+    }
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteTextures(1, &occupancy);
+    if (!levels.empty()) {
+        glDeleteTextures(levels.size(), &levels[0]);
+    }
+    levels.clear();
+    sizes.clear();
+    glDeleteBuffers(1, &pbo);
+    fbo = 0;
+}
+
+void RegionOfInterest::setup(int width,int height,int tileSize,int margin) {
+    release();
+    
+    this->width = width;
+    this->height = height;
+    this->tileSize = tileSize;
+    this->margin = margin;
+    columns = (width+tileSize-1)/tileSize;
+    rows = (height+tileSize-1)/tileSize;
+    
+    glGenFramebuffers(1, &fbo);
+    glGenVertexArrays(1, &vao);
+    occupancy = createTargetTexture(columns, rows, GL_R8, GL_RED);
+    
+    // one reduction level per halving down to the cell size, the first one thresholds
+    cell = 1;
+    int w = width;
+    int h = height;
+    while (cell*8<=tileSize) {
+        cell*=2;
+        w = (w+1)/2;
+        h = (h+1)/2;
+        levels.push_back(createTargetTexture(w, h, GL_R8, GL_RED));
+        sizes.push_back(ofVec2f(w,h));
+    }
+    
+    glGenBuffers(1, &pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, columns*rows, NULL, GL_STREAM_READ);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    // until the first readback everything is active
+    tiles.assign(columns*rows, 255);
+    generation++;
+    numActiveTiles = columns*rows;
+    activePixels = width*height;
+    bounds = ofRectangle(0, 0, width, height);
+    mesh.clear();
+    mesh.setMode(OF_PRIMITIVE_TRIANGLE_FAN);
+    mesh.addVertex(ofVec3f(0,0));
+    mesh.addTexCoord(ofVec2f(0,0));
+    mesh.addVertex(ofVec3f(width,0));
+    mesh.addTexCoord(ofVec2f(1,0));
+    mesh.addVertex(ofVec3f(width,height));
+    mesh.addTexCoord(ofVec2f(1,1));
+    mesh.addVertex(ofVec3f(0,height));
+    mesh.addTexCoord(ofVec2f(0,1));
+    
+    createQuadShader(reduceShader, STRINGIFY(
+                                             \n#version 150\n
+                                             uniform sampler2D src;
+                                             uniform int first;
+                                             uniform float threshold;
+                                             out float fragColor;
+                                             
+                                             void main(void) {
+                                                 ivec2 p = 2*ivec2(gl_FragCoord.xy);
+                                                 ivec2 last = textureSize(src,0)-1;
+                                                 float v = max(max(texelFetch(src,min(p,last),0).r,
+                                                                   texelFetch(src,min(p+ivec2(1,0),last),0).r),
+                                                               max(texelFetch(src,min(p+ivec2(0,1),last),0).r,
+                                                                   texelFetch(src,min(p+ivec2(1,1),last),0).r));
+                                                 fragColor = first == 1 ? float(v > threshold) : v;
+                                             }
+                                             ));
+    
+    createQuadShader(occupancyShader, STRINGIFY(
+                                                \n#version 150\n
+                                                uniform sampler2D cells;
+                                                uniform int cell;
+                                                uniform int tileSize;
+                                                uniform int margin;
+                                                uniform ivec2 maskSize;
+                                                uniform float threshold;
+                                                out float fragColor;
+                                                
+                                                void main(void) {
+                                                    ivec2 tile = ivec2(gl_FragCoord.xy);
+                                                    ivec2 lo = max(tile*tileSize-margin,ivec2(0))/cell;
+                                                    ivec2 hi = (min((tile+1)*tileSize+margin,maskSize)+cell-1)/cell;
+                                                    float occupied = 0.0;
+                                                    for (int y = lo.y; y < hi.y && occupied == 0.0; y++) {
+                                                        for (int x = lo.x; x < hi.x; x++) {
+                                                            if (texelFetch(cells,ivec2(x,y),0).r > threshold) {
+                                                                occupied = 1.0;
+                                                                break;
+                                                            }
+                                                        }
+                                                    }
+                                                    fragColor = occupied;
+                                                }
+                                                ));
+}
+
+void RegionOfInterest::setThreshold(float threshold) {
+    this->threshold = threshold;
+}
+
+void RegionOfInterest::update(ofTexture &mask) {
+    if (!fbo) {
+        return;
+    }
+    
+    resolve();
+    
+    GLint previousFbo;
+    GLint previousViewport[4];
+    GLint previousVao;
+    GLint previousAlignment;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVao);
+    glGetIntegerv(GL_PACK_ALIGNMENT, &previousAlignment);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_BLEND);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glBindVertexArray(vao);
+    
+    ofTextureData &maskData = mask.getTextureData();
+    reduceShader.begin();
+    reduceShader.setUniform1f("threshold", threshold);
+    for (int i=0;i<levels.size();i++) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, levels[i], 0);
+        glViewport(0, 0, sizes[i].x, sizes[i].y);
+        if (i==0) {
+            reduceShader.setUniformTexture("src", maskData.textureTarget, maskData.textureID, 0);
+        } else {
+            reduceShader.setUniformTexture("src", GL_TEXTURE_2D, levels[i-1], 0);
+        }
+        reduceShader.setUniform1i("first", i==0);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    reduceShader.end();
+    
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, occupancy, 0);
+    glViewport(0, 0, columns, rows);
+    occupancyShader.begin();
+    if (levels.empty()) {
+        occupancyShader.setUniformTexture("cells", maskData.textureTarget, maskData.textureID, 0);
+        occupancyShader.setUniform1f("threshold", threshold);
+    } else {
+        occupancyShader.setUniformTexture("cells", GL_TEXTURE_2D, levels.back(), 0);
+        occupancyShader.setUniform1f("threshold", 0.5); // cells are already thresholded
+    }
+    occupancyShader.setUniform1i("cell", cell);
+    occupancyShader.setUniform1i("tileSize", tileSize);
+    occupancyShader.setUniform1i("margin", margin);
+    occupancyShader.setUniform2i("maskSize", width, height);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    occupancyShader.end();
+    
+    // read into the pixel buffer, resolve() maps it once the fence has passed
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+    glReadPixels(0, 0, columns, rows, GL_RED, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, previousAlignment);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    glBindVertexArray(previousVao);
+    if (blend) {
+        glEnable(GL_BLEND);
+    }
+}
+
+void RegionOfInterest::resolve() {
+    if (!fence) {
+        return;
+    }
+    
+    // issued an update earlier, normally long done
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(fence);
+    fence = 0;
+    
+    bool changed = false;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+    unsigned char *data = (unsigned char *)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (data) {
+        changed = !equal(tiles.begin(), tiles.end(), data);
+        if (changed) {
+            tiles.assign(data, data+tiles.size());
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    if (changed) {
+        buildMesh();
+        generation++;
+    }
+}
+
+void RegionOfInterest::buildMesh() {
+    mesh.clear();
+    mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+    numActiveTiles = 0;
+    activePixels = 0;
+    int x0 = width;
+    int y0 = height;
+    int x1 = 0;
+    int y1 = 0;
+    for (int y=0;y<rows;y++) {
+        for (int x=0;x<columns;x++) {
+            if (!isActive(x, y)) {
+                continue;
+            }
+            
+            float left = x*tileSize;
+            float top = y*tileSize;
+            float right = min((x+1)*tileSize,width);
+            float bottom = min((y+1)*tileSize,height);
+            
+            const float corners[6][2] = {{left,top},{right,top},{right,bottom},{left,top},{right,bottom},{left,bottom}};
+            for (int i=0;i<6;i++) {
+                mesh.addVertex(ofVec3f(corners[i][0],corners[i][1]));
+                mesh.addTexCoord(ofVec2f(corners[i][0]/width,corners[i][1]/height));
+            }
+            
+            numActiveTiles++;
+            activePixels += (right-left)*(bottom-top);
+            x0 = min(x0,(int)left);
+            y0 = min(y0,(int)top);
+            x1 = max(x1,(int)right);
+            y1 = max(y1,(int)bottom);
+        }
+    }
+    bounds = numActiveTiles ? ofRectangle(x0, y0, x1-x0, y1-y0) : ofRectangle(0, 0, 0, 0);
+}
+
+void RegionOfInterest::draw() {
+    if (numActiveTiles) {
+        mesh.draw();
+    }
+}
+
+ofMesh &RegionOfInterest::getMesh() {
+    return mesh;
+}
+
+void RegionOfInterest::begin() {
+    // the bounds are in the coordinates draw() uses, map them through the current matrices and
+    // viewport so the scissor lands where the tiles do on a flipped or unflipped surface
+    ofMatrix4x4 modelViewProjection = ofGetCurrentMatrix(OF_MATRIX_MODELVIEW)*ofGetCurrentMatrix(OF_MATRIX_PROJECTION);
+    ofVec3f a = modelViewProjection.preMult(ofVec3f(bounds.x,bounds.y));
+    ofVec3f b = modelViewProjection.preMult(ofVec3f(bounds.x+bounds.width,bounds.y+bounds.height));
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    int x0 = floor(viewport[0]+(min(a.x,b.x)+1)*0.5*viewport[2]+0.5);
+    int x1 = floor(viewport[0]+(max(a.x,b.x)+1)*0.5*viewport[2]+0.5);
+    int y0 = floor(viewport[1]+(min(a.y,b.y)+1)*0.5*viewport[3]+0.5);
+    int y1 = floor(viewport[1]+(max(a.y,b.y)+1)*0.5*viewport[3]+0.5);
+    
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x0, y0, x1-x0, y1-y0);
+}
+
+void RegionOfInterest::end() {
+    glDisable(GL_SCISSOR_TEST);
+}
+
+bool RegionOfInterest::isActive(int x,int y) {
+    return tiles[y*columns+x]>127;
+}
+
+int RegionOfInterest::getNumTiles() {
+    return columns*rows;
+}
+
+int RegionOfInterest::getNumActiveTiles() {
+    return numActiveTiles;
+}
+
+float RegionOfInterest::getCoverage() {
+    return (float)activePixels/(width*height);
+}
+
+ofRectangle RegionOfInterest::getBounds() {
+    return bounds;
+}
+
+unsigned RegionOfInterest::getGeneration() {
+    return generation;
+}
+
+string RegionOfInterest::getReport() {
+    stringstream report;
+    report << numActiveTiles << "/" << getNumTiles() << " tiles of " << tileSize << "x" << tileSize << " active" << endl;
+    report << "tiles: " << getCoverage()*100 << "% of pixels processed" << endl;
+    report << "scissor: " << bounds.width*bounds.height*100/(width*height) << "% of pixels processed" << endl;
+    return report.str();
+}
@@ -0,0 +1,74 @@
+//
+//  RegionOfInterest.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "Shaders.h"
+
+// active tiles of a mask. the mask is thresholded and max reduced 2x2 per pass down to cells
+// of about a quarter tile, a tile is active when a cell within margin pixels of it holds a mask
+// value above the threshold (the margin is rounded up to whole cells). the tile map (one byte
+// per tile) is read back through a pixel buffer on the next update so the gpu is never waited
+// on, the tiles therefore lag the mask by one update and everything is active until the first
+// readback. margin should cover the footprint of the effects drawn through it, e.g. the blur
+// radius, plus the motion of the mask between two updates
+class RegionOfInterest {
+public:
+    
+    RegionOfInterest();
+    ~RegionOfInterest();
+    
+    void setup(int width,int height,int tileSize=32,int margin=0);
+    void setThreshold(float threshold);
+    
+    void update(ofTexture &mask); // resolves the previous readback, then starts one for mask
+    void resolve(); // picks up a pending readback without starting a new one
+    
+    void draw(); // active tiles, same coordinates and texcoords as a full screen quad
+    ofMesh &getMesh(); // what draw() draws, empty without active tiles
+    void begin(); // scissor to the bounds of the active tiles, under the current matrices
+    void end();
+    
+    bool isActive(int x,int y); // tile coordinates
+    int getNumTiles();
+    int getNumActiveTiles();
+    float getCoverage(); // fraction of the pixels inside active tiles
+    ofRectangle getBounds(); // in draw() coordinates
+    unsigned getGeneration(); // bumped whenever the active tiles change
+    string getReport();
+    
+private:
+    
+    void release();
+    void buildMesh();
+    
+    int width;
+    int height;
+    int tileSize;
+    int margin;
+    int cell;
+    float threshold;
+    int columns;
+    int rows;
+    
+    GLuint fbo;
+    GLuint vao;
+    GLuint occupancy;
+    vector<GLuint> levels;
+    vector<ofVec2f> sizes;
+    GLuint pbo;
+    GLsync fence;
+    vector<unsigned char> tiles;
+    unsigned generation;
+    int numActiveTiles;
+    int activePixels;
+    ofRectangle bounds;
+    
+    ofShader reduceShader;
+    ofShader occupancyShader;
+    ofMesh mesh;
+};
@@ -0,0 +1,134 @@
+//
+//  RenderTargetPool.cpp
+//  depthBlur
+//
+//
+
+#include "RenderTargetPool.h"
+
+static size_t getTargetBytes(const RenderTargetRequest &request) {
+    return (size_t)request.width*request.height*getFormatBytes(request.format);
+}
+
+void RenderTargetPool::clear() {
+    requests.clear();
+    assignment.clear();
+    targetSettings.clear();
+    targets.clear();
+}
+
+int RenderTargetPool::addTarget(int width,int height,ShaderFormat format,int first,int last) {
+    RenderTargetRequest request;
+    request.width = width;
+    request.height = height;
+    request.format = format;
+    request.first = first;
+    request.last = max(first,last);
+    requests.push_back(request);
+    return requests.size()-1;
+}
+
+void RenderTargetPool::allocate() {
+    
+    vector<int> order;
+    for (int i=0;i<requests.size();i++) {
+        order.push_back(i);
+    }
+    
+    // greedy interval assignment in order of the writing pass
+    for (int i=1;i<order.size();i++) {
+        for (int j=i;j>0 && requests[order[j]].first<requests[order[j-1]].first;j--) {
+            swap(order[j],order[j-1]);
+        }
+    }
+    
+    assignment.assign(requests.size(),-1);
+    targetSettings.clear();
+    vector<int> occupant;
+    
+    for (vector<int>::iterator iter=order.begin();iter!=order.end();iter++) {
+        RenderTargetRequest &request = requests[*iter];
+        
+        int target = -1;
+        for (int i=0;i<targetSettings.size();i++) {
+            RenderTargetRequest &settings = targetSettings[i];
+            RenderTargetRequest &current = requests[occupant[i]];
+            // a pass can't read and write the same target, hence the strict comparison
+            if (settings.width==request.width && settings.height==request.height && settings.format==request.format && current.last<request.first) {
+                target = i;
+                break;
+            }
+        }
+        
+        if (target==-1) {
+            targetSettings.push_back(request);
+            occupant.push_back(*iter);
+            target = targetSettings.size()-1;
+        }
+        
+        occupant[target] = *iter;
+        assignment[*iter] = target;
+    }
+    
+    targets.clear();
+    for (vector<RenderTargetRequest>::iterator iter=targetSettings.begin();iter!=targetSettings.end();iter++) {
+        ofPtr<ofFbo> fbo(new ofFbo);
+        allocateTarget(*fbo, iter->width, iter->height, iter->format);
+        targets.push_back(fbo);
+    }
+}
+
+ofFbo &RenderTargetPool::getTarget(int request) {
+    return *targets[assignment[request]];
+}
+
+int RenderTargetPool::getNumTargets() {
+    return targets.size();
+}
+
+int RenderTargetPool::getNumRequests() {
+    return requests.size();
+}
+
+size_t RenderTargetPool::getRequestedBytes() {
+    size_t bytes = 0;
+    for (vector<RenderTargetRequest>::iterator iter=requests.begin();iter!=requests.end();iter++) {
+        bytes+=getTargetBytes(*iter);
+    }
+    return bytes;
+}
+
+size_t RenderTargetPool::getAllocatedBytes() {
+    size_t bytes = 0;
+    for (vector<RenderTargetRequest>::iterator iter=targetSettings.begin();iter!=targetSettings.end();iter++) {
+        bytes+=getTargetBytes(*iter);
+    }
+    return bytes;
+}
+
+size_t RenderTargetPool::getPeakBytes() {
+    size_t peak = 0;
+    int lastPass = 0;
+    for (vector<RenderTargetRequest>::iterator iter=requests.begin();iter!=requests.end();iter++) {
+        lastPass = max(lastPass,iter->last);
+    }
+    
+    for (int pass=0;pass<=lastPass;pass++) {
+        size_t bytes = 0;
+        for (vector<RenderTargetRequest>::iterator iter=requests.begin();iter!=requests.end();iter++) {
+            if (iter->first<=pass && pass<=iter->last) {
+                bytes+=getTargetBytes(*iter);
+            }
+        }
+        peak = max(peak,bytes);
+    }
+    return peak;
+}
+
+string RenderTargetPool::getReport() {
+    stringstream report;
+    report << "render targets: " << getNumRequests() << " requested, " << getNumTargets() << " allocated" << endl;
+    report << "memory: " << getRequestedBytes()/1024 << " KB before, " << getAllocatedBytes()/1024 << " KB after, ";
+    report << getPeakBytes()/1024 << " KB live at peak" << endl;
+    return report.str();
+}
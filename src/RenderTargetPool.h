@@ -0,0 +1,44 @@
+//
+//  RenderTargetPool.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "Shaders.h"
+
+struct RenderTargetRequest {
+    int width;
+    int height;
+    ShaderFormat format;
+    int first;  // pass writing the target
+    int last;   // last pass reading it
+};
+
+// transient targets for a chain of passes, requests whose lifetimes do not overlap
+// share the same fbo when they have the same size and format
+class RenderTargetPool {
+public:
+    
+    void clear();
+    int addTarget(int width,int height,ShaderFormat format,int first,int last);
+    void allocate();
+    
+    ofFbo &getTarget(int request);
+    int getNumTargets();
+    int getNumRequests();
+    
+    size_t getRequestedBytes(); // one target per request
+    size_t getAllocatedBytes(); // after aliasing
+    size_t getPeakBytes();      // live targets at the busiest pass
+    string getReport();
+    
+private:
+    
+    vector<RenderTargetRequest> requests;
+    vector<int> assignment;
+    vector<RenderTargetRequest> targetSettings;
+    vector<ofPtr<ofFbo> > targets;
+};
@@ -0,0 +1,337 @@
+//
+//  ShaderChain.cpp
+//  depthBlur
+//
+//
+
+#include "ShaderChain.h"
+
+// inputs are encoded as negative sources so pass indices stay valid sources
+static int getInputIndex(int source) {
+    return -source-1;
+}
+
+void ShaderChain::setup(int width,int height) {
+    this->width = width;
+    this->height = height;
+    lazy = false;
+    numSkipped = 0;
+    tracer = NULL;
+    stencilPass = -1;
+    inputs.clear();
+    inputVersions.clear();
+    passes.clear();
+    pool.clear();
+    
+    quad.clear();
+    quad.setMode(OF_PRIMITIVE_TRIANGLE_FAN);
+    quad.addVertex(ofVec3f(0,0));
+    quad.addTexCoord(ofVec2f(0,0));
+    quad.addVertex(ofVec3f(width,0));
+    quad.addTexCoord(ofVec2f(1,0));
+    quad.addVertex(ofVec3f(width,height));
+    quad.addTexCoord(ofVec2f(1,1));
+    quad.addVertex(ofVec3f(0,height));
+    quad.addTexCoord(ofVec2f(0,1));
+}
+
+void ShaderChain::setLazy(bool lazy) {
+    this->lazy = lazy;
+}
+
+void ShaderChain::setTracer(FrameTracer *tracer) {
+    this->tracer = tracer;
+}
+
+int ShaderChain::addInput(ofTexture &texture) {
+    inputs.push_back(&texture);
+    inputVersions.push_back(0);
+    return -(int)inputs.size();
+}
+
+static ShaderPass createPass(ShaderFormat format) {
+    ShaderPass pass;
+    pass.shader = NULL;
+    pass.async = NULL;
+    pass.format = format;
+    pass.keep = false;
+    pass.target = -1;
+    pass.region = NULL;
+    pass.regionSource = 0;
+    pass.stencilTest = false;
+    pass.version = 0;
+    pass.generation = 0;
+    return pass;
+}
+
+int ShaderChain::addPass(ofShader &shader,ShaderFormat format) {
+    ShaderPass pass = createPass(format);
+    pass.shader = &shader;
+    passes.push_back(pass);
+    return passes.size()-1;
+}
+
+int ShaderChain::addPass(AsyncShader &shader,ShaderFormat format) {
+    ShaderPass pass = createPass(format);
+    pass.async = &shader;
+    passes.push_back(pass);
+    return passes.size()-1;
+}
+
+void ShaderChain::setTexture(int pass,string name,int source) {
+    vector<pair<string,int> > &textures = passes[pass].textures;
+    for (vector<pair<string,int> >::iterator iter=textures.begin();iter!=textures.end();iter++) {
+        if (iter->first==name) {
+            if (iter->second!=source) {
+                iter->second = source;
+                passes[pass].version++;
+            }
+            return;
+        }
+    }
+    textures.push_back(make_pair(name,source));
+    passes[pass].version++;
+}
+
+void ShaderChain::setUniform(int pass,string name,float value) {
+    map<string,float>::iterator iter = passes[pass].floats.find(name);
+    if (iter==passes[pass].floats.end() || iter->second!=value) {
+        passes[pass].floats[name] = value;
+        passes[pass].version++;
+    }
+}
+
+void ShaderChain::setUniform(int pass,string name,float x,float y) {
+    map<string,ofVec2f>::iterator iter = passes[pass].vecs.find(name);
+    if (iter==passes[pass].vecs.end() || iter->second!=ofVec2f(x,y)) {
+        passes[pass].vecs[name] = ofVec2f(x,y);
+        passes[pass].version++;
+    }
+}
+
+void ShaderChain::setUniform(int pass,string name,int value) {
+    map<string,int>::iterator iter = passes[pass].ints.find(name);
+    if (iter==passes[pass].ints.end() || iter->second!=value) {
+        passes[pass].ints[name] = value;
+        passes[pass].version++;
+    }
+}
+
+void ShaderChain::keep(int pass) {
+    passes[pass].keep = true;
+}
+
+void ShaderChain::setRegion(int pass,RegionOfInterest &region,int source) {
+    passes[pass].region = &region;
+    passes[pass].regionSource = source;
+    passes[pass].version++;
+}
+
+void ShaderChain::setStencilMask(int pass) {
+    if (stencilPass>=0) {
+        passes[stencilPass].version++;
+    }
+    stencilPass = pass;
+    passes[pass].version++;
+}
+
+void ShaderChain::setStencilTest(int pass,bool test) {
+    if (passes[pass].stencilTest!=test) {
+        passes[pass].stencilTest = test;
+        passes[pass].version++;
+    }
+}
+
+void ShaderChain::invalidate(int source) {
+    if (source<0) {
+        inputVersions[getInputIndex(source)]++;
+    } else {
+        passes[source].version++;
+    }
+}
+
+void ShaderChain::allocate() {
+    
+    if (passes.empty()) {
+        return;
+    }
+    
+    // cached outputs of a lazy chain have to survive until they are read again
+    vector<int> last(passes.size());
+    for (int i=0;i<passes.size();i++) {
+        last[i] = passes[i].keep || lazy ? passes.size() : i;
+    }
+    last.back() = passes.size(); // the chain output
+    
+    for (int i=0;i<passes.size();i++) {
+        vector<pair<string,int> > &textures = passes[i].textures;
+        for (vector<pair<string,int> >::iterator iter=textures.begin();iter!=textures.end();iter++) {
+            if (iter->second>=0) {
+                last[iter->second] = max(last[iter->second],i);
+            }
+        }
+        if (passes[i].region && passes[i].regionSource>=0) {
+            last[passes[i].regionSource] = max(last[passes[i].regionSource],i);
+        }
+    }
+    
+    pool.clear();
+    for (int i=0;i<passes.size();i++) {
+        passes[i].target = pool.addTarget(width, height, passes[i].format, i, last[i]);
+        passes[i].rendered.clear();
+    }
+    pool.allocate();
+    
+    if (stencilPass>=0) {
+        stencil.setup(width, height);
+        for (int i=0;i<passes.size();i++) {
+            if (i==stencilPass || passes[i].stencilTest) {
+                if (i<stencilPass) {
+                    ofLogWarning("ShaderChain") << "pass " << i << " tests the stencil before mask pass " << stencilPass;
+                }
+                stencil.attach(pool.getTarget(passes[i].target));
+            }
+        }
+    }
+}
+
+void ShaderChain::update() {
+    // tiles read back since the last update count in the signatures below
+    for (int i=0;i<passes.size();i++) {
+        if (passes[i].region) {
+            passes[i].region->resolve();
+        }
+    }
+    
+    set<RegionOfInterest *> regions;
+    numSkipped = 0;
+    for (int i=0;i<passes.size();i++) {
+        vector<unsigned> signature = getSignature(i);
+        if (lazy && signature==passes[i].rendered) {
+            numSkipped++;
+            continue;
+        }
+        
+        int span = tracer ? tracer->begin("pass", i) : -1;
+        RegionOfInterest *region = passes[i].region;
+        if (region && regions.insert(region).second) {
+            region->update(getTexture(passes[i].regionSource));
+        }
+        drawPass(i);
+        if (tracer) {
+            tracer->end(span);
+        }
+        passes[i].rendered = signature;
+        passes[i].generation++;
+    }
+}
+
+unsigned ShaderChain::getVersion(int source) {
+    if (source<0) {
+        return inputVersions[getInputIndex(source)];
+    }
+    return passes[source].generation;
+}
+
+vector<unsigned> ShaderChain::getSignature(int i) {
+    ShaderPass &pass = passes[i];
+    vector<unsigned> signature;
+    signature.push_back(pass.version);
+    if (pass.async) {
+        // renders again once a build becomes current
+        signature.push_back(pass.async->getProgram());
+    }
+    for (vector<pair<string,int> >::iterator iter=pass.textures.begin();iter!=pass.textures.end();iter++) {
+        signature.push_back(getVersion(iter->second));
+    }
+    if (pass.region) {
+        signature.push_back(getVersion(pass.regionSource));
+        signature.push_back(pass.region->getGeneration());
+    }
+    if (pass.stencilTest && stencilPass>=0) {
+        signature.push_back(getVersion(stencilPass));
+    }
+    return signature;
+}
+
+template<class Shader>
+void ShaderChain::setUniforms(Shader &shader,ShaderPass &pass) {
+    int unit = 0;
+    for (vector<pair<string,int> >::iterator iter=pass.textures.begin();iter!=pass.textures.end();iter++) {
+        shader.setUniformTexture(iter->first, getTexture(iter->second), unit++);
+    }
+    for (map<string,float>::iterator iter=pass.floats.begin();iter!=pass.floats.end();iter++) {
+        shader.setUniform1f(iter->first, iter->second);
+    }
+    for (map<string,ofVec2f>::iterator iter=pass.vecs.begin();iter!=pass.vecs.end();iter++) {
+        shader.setUniform2f(iter->first, iter->second.x, iter->second.y);
+    }
+    for (map<string,int>::iterator iter=pass.ints.begin();iter!=pass.ints.end();iter++) {
+        shader.setUniform1i(iter->first, iter->second);
+    }
+}
+
+void ShaderChain::drawPass(int i) {
+    ShaderPass &pass = passes[i];
+    ofFbo &fbo = pool.getTarget(pass.target);
+    
+    bool stenciled = stencilPass>=0 && (i==stencilPass || pass.stencilTest);
+    
+    fbo.begin();
+    ofClear(0);
+    if (i==stencilPass) {
+        stencil.clear();
+        stencil.beginWrite();
+    } else if (stenciled) {
+        stencil.beginTest();
+    }
+    if (pass.shader) {
+        pass.shader->begin();
+        setUniforms(*pass.shader, pass);
+        if (pass.region) {
+            pass.region->draw();
+        } else {
+            quad.draw();
+        }
+        pass.shader->end();
+    } else if (pass.async->isReady()) {
+        // the raw program is not known to the renderer, so it gets the matrices and
+        // geometry itself
+        pass.async->begin(ofGetCurrentMatrix(OF_MATRIX_MODELVIEW)*ofGetCurrentMatrix(OF_MATRIX_PROJECTION));
+        setUniforms(*pass.async, pass);
+        pass.async->draw(pass.region ? pass.region->getMesh() : quad);
+        pass.async->end();
+    }
+    
+    if (stenciled) {
+        stencil.end();
+    }
+    fbo.end();
+}
+
+ofTexture &ShaderChain::getTexture(int source) {
+    if (source<0) {
+        return *inputs[getInputIndex(source)];
+    }
+    return pool.getTarget(passes[source].target).getTextureReference();
+}
+
+ShaderFormat ShaderChain::getFormat(int pass) {
+    return passes[pass].format;
+}
+
+RenderTargetPool &ShaderChain::getPool() {
+    return pool;
+}
+
+StencilMask &ShaderChain::getStencil() {
+    return stencil;
+}
+
+int ShaderChain::getNumPasses() {
+    return passes.size();
+}
+
+int ShaderChain::getNumSkipped() {
+    return numSkipped;
+}
@@ -0,0 +1,97 @@
+//
+//  ShaderChain.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "Shaders.h"
+#include "RenderTargetPool.h"
+#include "RegionOfInterest.h"
+#include "FrameTracer.h"
+#include "StencilMask.h"
+#include "AsyncShader.h"
+
+struct ShaderPass {
+    ofShader *shader;
+    AsyncShader *async; // instead of shader, the pass is cleared until the program is ready
+    ShaderFormat format;
+    vector<pair<string,int> > textures; // uniform name, source
+    map<string,float> floats;
+    map<string,ofVec2f> vecs;
+    map<string,int> ints;
+    bool keep;
+    int target;
+    RegionOfInterest *region;
+    int regionSource;
+    bool stencilTest;
+    unsigned version; // bumped when a texture or uniform of the pass changes
+    unsigned generation; // bumped every time the pass renders
+    vector<unsigned> rendered; // versions of everything read by the last render
+};
+
+// a sequence of full screen passes, each pass renders into a pooled target.
+// sources are either external inputs (addInput) or the output of an earlier pass (addPass).
+// a lazy chain keeps every target and only renders passes whose sources or uniforms changed
+// since their last render, inputs count as changed only when invalidated
+class ShaderChain {
+public:
+    
+    void setup(int width,int height);
+    void setLazy(bool lazy); // before allocate
+    void setTracer(FrameTracer *tracer); // spans every pass, NULL to stop
+    
+    int addInput(ofTexture &texture);
+    int addPass(ofShader &shader,ShaderFormat format=SHADER_FORMAT_RGBA8);
+    int addPass(AsyncShader &shader,ShaderFormat format=SHADER_FORMAT_RGBA8);
+    
+    void setTexture(int pass,string name,int source);
+    void setUniform(int pass,string name,float value);
+    void setUniform(int pass,string name,float x,float y);
+    void setUniform(int pass,string name,int value);
+    void keep(int pass); // read after update, never aliased
+    
+    // draw the pass only over the tiles active in source, the rest of its target is cleared.
+    // the region is updated once per update, before the first pass using it
+    void setRegion(int pass,RegionOfInterest &region,int source);
+    
+    // the mask pass also writes the stencil shared by the chain's targets wherever it does not
+    // discard (see getStencilMaskFragment), later passes with the test only shade those pixels
+    // and keep the cleared color elsewhere
+    void setStencilMask(int pass);
+    void setStencilTest(int pass,bool test=true);
+    
+    void invalidate(int source); // an input texture was updated or a pass has to render again
+    
+    void allocate();
+    void update();
+    
+    ofTexture &getTexture(int source);
+    ShaderFormat getFormat(int pass);
+    RenderTargetPool &getPool();
+    StencilMask &getStencil();
+    int getNumPasses();
+    int getNumSkipped(); // passes reused by the last update
+    
+protected:
+    
+    void drawPass(int pass);
+    template<class Shader> void setUniforms(Shader &shader,ShaderPass &pass);
+    unsigned getVersion(int source);
+    vector<unsigned> getSignature(int pass);
+    
+    int width;
+    int height;
+    bool lazy;
+    int numSkipped;
+    FrameTracer *tracer;
+    int stencilPass;
+    StencilMask stencil;
+    vector<ofTexture *> inputs;
+    vector<unsigned> inputVersions;
+    vector<ShaderPass> passes;
+    RenderTargetPool pool;
+    ofMesh quad;
+};
@@ -0,0 +1,332 @@
+//
+//  ShaderCost.cpp
+//  depthBlur
+//
+//
+
+#include "ShaderCost.h"
+#include "Shaders.h"
+
+ShaderLimits getShaderLimits() {
+    ShaderLimits limits;
+    glGetIntegerv(GL_MAX_VARYING_COMPONENTS, &limits.maxVaryingComponents);
+    glGetIntegerv(GL_MAX_VERTEX_OUTPUT_COMPONENTS, &limits.maxVertexOutputComponents);
+    glGetIntegerv(GL_MAX_FRAGMENT_INPUT_COMPONENTS, &limits.maxFragmentInputComponents);
+    glGetIntegerv(GL_MAX_VERTEX_UNIFORM_COMPONENTS, &limits.maxVertexUniformComponents);
+    glGetIntegerv(GL_MAX_FRAGMENT_UNIFORM_COMPONENTS, &limits.maxFragmentUniformComponents);
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &limits.maxTextureUnits);
+    return limits;
+}
+
+ShaderLimits getMinimumShaderLimits() {
+    ShaderLimits limits;
+    limits.maxVaryingComponents = 60;
+    limits.maxVertexOutputComponents = 64;
+    limits.maxFragmentInputComponents = 128;
+    limits.maxVertexUniformComponents = 1024;
+    limits.maxFragmentUniformComponents = 1024;
+    limits.maxTextureUnits = 16;
+    return limits;
+}
+
+static bool isIdentifier(char c) {
+    return isalnum(c) || c=='_';
+}
+
+// comments and preprocessor lines removed
+static string getCode(const string &source) {
+    string code;
+    bool lineStart = true;
+    for (size_t i=0;i<source.size();i++) {
+        if (source.compare(i, 2, "//")==0) {
+            i = source.find('\n', i);
+            if (i==string::npos) {
+                break;
+            }
+        } else if (source.compare(i, 2, "/*")==0) {
+            i = source.find("*/", i);
+            if (i==string::npos) {
+                break;
+            }
+            i++;
+            continue;
+        } else if (lineStart && source[i]=='#') {
+            i = source.find('\n', i);
+            if (i==string::npos) {
+                break;
+            }
+        }
+        if (source[i]=='\n') {
+            lineStart = true;
+        } else if (!isspace(source[i])) {
+            lineStart = false;
+        }
+        code += source[i];
+    }
+    return code;
+}
+
+static vector<string> getTokens(const string &code) {
+    vector<string> tokens;
+    for (size_t i=0;i<code.size();) {
+        if (isspace(code[i])) {
+            i++;
+        } else if (isIdentifier(code[i]) || (code[i]=='.' && i+1<code.size() && isdigit(code[i+1]))) {
+            size_t j = i;
+            while (j<code.size() && (isIdentifier(code[j]) || code[j]=='.' || ((code[j]=='-' || code[j]=='+') && (code[j-1]=='e' || code[j-1]=='E') && isdigit(code[i])))) {
+                j++;
+            }
+            tokens.push_back(code.substr(i, j-i));
+            i = j;
+        } else if (i+1<code.size() && strchr("+-*/<>=!&|", code[i]) && (code[i+1]=='=' || (code[i+1]==code[i] && strchr("+-&|", code[i])))) {
+            tokens.push_back(code.substr(i, 2));
+            i += 2;
+        } else {
+            tokens.push_back(code.substr(i, 1));
+            i++;
+        }
+    }
+    return tokens;
+}
+
+static int getComponents(const string &type) {
+    if (type=="float" || type=="int" || type=="uint" || type=="bool") {
+        return 1;
+    }
+    if (type.size()==4 && type.compare(0, 3, "vec")==0) {
+        return type[3]-'0';
+    }
+    if (type.size()==5 && type.compare(1, 3, "vec")==0) {
+        return type[4]-'0';
+    }
+    if (type=="mat2" || type=="mat3" || type=="mat4") {
+        return (type[3]-'0')*(type[3]-'0');
+    }
+    return 0;
+}
+
+static int getSlots(const string &type) {
+    if (type.compare(0, 3, "mat")==0) {
+        return type[3]-'0';
+    }
+    return 1;
+}
+
+struct Declarations {
+    int inputs; // padded
+    int outputs; // padded
+    int uniforms;
+    int samplers;
+};
+
+// in, out and uniform declarations at global scope
+static Declarations getDeclarations(const vector<string> &tokens) {
+    Declarations declarations = {0,0,0,0};
+    int depth = 0;
+    for (size_t i=0;i<tokens.size();i++) {
+        if (tokens[i]=="{") {
+            depth++;
+        } else if (tokens[i]=="}") {
+            depth--;
+        }
+        if (depth || (tokens[i]!="in" && tokens[i]!="out" && tokens[i]!="uniform")) {
+            continue;
+        }
+        string storage = tokens[i];
+        string type = i+1<tokens.size() ? tokens[++i] : "";
+        while (type=="highp" || type=="mediump" || type=="lowp" || type=="flat" || type=="smooth" || type=="noperspective") {
+            type = i+1<tokens.size() ? tokens[++i] : "";
+        }
+        
+        for (i++;i<tokens.size() && tokens[i]!=";";i++) {
+            if (!isIdentifier(tokens[i][0])) {
+                continue;
+            }
+            int count = 1;
+            if (i+3<tokens.size() && tokens[i+1]=="[" && tokens[i+3]=="]") {
+                count = atoi(tokens[i+2].c_str());
+                i += 3;
+            }
+            if (type.find("sampler")!=string::npos) {
+                declarations.samplers += count;
+            } else if (storage=="uniform") {
+                declarations.uniforms += count*getComponents(type);
+            } else if (storage=="in") {
+                declarations.inputs += count*getSlots(type)*4;
+            } else {
+                declarations.outputs += count*getSlots(type)*4;
+            }
+        }
+    }
+    return declarations;
+}
+
+static int getTexels(const string &function) {
+    if (function.compare(0, 13, "textureGather")==0) {
+        return 4;
+    }
+    if (function.compare(0, 7, "texture")==0 || function.compare(0, 10, "texelFetch")==0) {
+        return function=="textureSize" ? 0 : 1;
+    }
+    return 0;
+}
+
+static bool isBuiltin(const string &function) {
+    static const char *builtins[] = {"min","max","clamp","mix","step","smoothstep","abs","sign","floor","ceil","fract","mod",
+        "sqrt","inversesqrt","pow","exp","exp2","log","log2","sin","cos","tan","atan","dot","cross","length","distance","normalize"};
+    for (int i=0;i<sizeof(builtins)/sizeof(builtins[0]);i++) {
+        if (function==builtins[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// trip count of for (int i = a; i < b; i++) with literal bounds, 0 when unknown
+static int getTripCount(const vector<string> &tokens,size_t begin,size_t end) {
+    vector<string> header(tokens.begin()+begin, tokens.begin()+end);
+    size_t first = find(header.begin(), header.end(), "=")-header.begin();
+    size_t condition = find(header.begin(), header.end(), ";")-header.begin();
+    if (first+2>=header.size() || condition+3>=header.size()) {
+        return 0;
+    }
+    
+    int sign = header[first+1]=="-" ? -1 : 1;
+    string from = sign<0 ? header[first+2] : header[first+1];
+    string comparison = header[condition+2];
+    string to = header[condition+3];
+    int toSign = 1;
+    if (to=="-" && condition+4<header.size()) {
+        toSign = -1;
+        to = header[condition+4];
+    }
+    if (!isdigit(from[0]) || !isdigit(to[0]) || (comparison!="<" && comparison!="<=")) {
+        return 0;
+    }
+    return max(toSign*atoi(to.c_str())-sign*atoi(from.c_str())+(comparison=="<=" ? 1 : 0),0);
+}
+
+static size_t getClosing(const vector<string> &tokens,size_t open,string left,string right) {
+    int depth = 0;
+    for (size_t i=open;i<tokens.size();i++) {
+        depth += tokens[i]==left;
+        depth -= tokens[i]==right;
+        if (!depth) {
+            return i;
+        }
+    }
+    return tokens.size()-1;
+}
+
+static void countStatements(const vector<string> &tokens,size_t begin,size_t end,int factor,ShaderCost &cost) {
+    for (size_t i=begin;i<end;i++) {
+        const string &token = tokens[i];
+        if (token=="for" && i+1<end && tokens[i+1]=="(") {
+            size_t header = getClosing(tokens, i+1, "(", ")");
+            int trips = getTripCount(tokens, i+2, header);
+            if (!trips) {
+                cost.dynamicLoops++;
+                trips = 1;
+            }
+            size_t bodyEnd = header+1;
+            if (header+1<end && tokens[header+1]=="{") {
+                bodyEnd = getClosing(tokens, header+1, "{", "}");
+            } else {
+                bodyEnd = find(tokens.begin()+header+1, tokens.begin()+end, ";")-tokens.begin();
+            }
+            countStatements(tokens, header+1, bodyEnd, factor*trips, cost);
+            i = bodyEnd;
+            continue;
+        }
+        
+        if (i+1<end && tokens[i+1]=="(" && isIdentifier(token[0])) {
+            int texels = getTexels(token);
+            if (texels) {
+                cost.textureFetches += factor*texels;
+                cost.fetchCalls += factor;
+            } else if (isBuiltin(token)) {
+                cost.aluOps += factor;
+            }
+        } else if (token=="+" || token=="-" || token=="*" || token=="/" || token=="+=" || token=="-=" || token=="*=" || token=="/=") {
+            cost.aluOps += factor;
+        }
+    }
+}
+
+// statements inside function bodies
+static void countFunctions(const vector<string> &tokens,ShaderCost &cost) {
+    for (size_t i=0;i<tokens.size();i++) {
+        if (tokens[i]=="{") {
+            size_t end = getClosing(tokens, i, "{", "}");
+            countStatements(tokens, i+1, end, 1, cost);
+            i = end;
+        }
+    }
+}
+
+ShaderCost analyzeShader(const string &vertex,const string &fragment) {
+    ShaderCost cost;
+    cost.textureFetches = 0;
+    cost.fetchCalls = 0;
+    cost.aluOps = 0;
+    cost.dynamicLoops = 0;
+    
+    vector<string> vertexTokens = getTokens(getCode(vertex));
+    vector<string> fragmentTokens = getTokens(getCode(fragment));
+    Declarations vertexDeclarations = getDeclarations(vertexTokens);
+    Declarations fragmentDeclarations = getDeclarations(fragmentTokens);
+    
+    cost.samplers = fragmentDeclarations.samplers+vertexDeclarations.samplers;
+    cost.varyingComponents = fragmentDeclarations.inputs;
+    cost.vertexOutputComponents = vertexDeclarations.outputs+4; // gl_Position counts against the limit
+    cost.vertexUniformComponents = vertexDeclarations.uniforms;
+    cost.fragmentUniformComponents = fragmentDeclarations.uniforms;
+    
+    countFunctions(fragmentTokens, cost);
+    return cost;
+}
+
+static void checkLimit(ShaderCost &cost,string name,int value,int limit) {
+    if (value>limit) {
+        cost.problems.push_back(name+" "+ofToString(value)+" over "+ofToString(limit));
+    }
+}
+
+bool checkLimits(ShaderCost &cost,const ShaderLimits &limits) {
+    cost.problems.clear();
+    checkLimit(cost, "varying components", cost.varyingComponents, limits.maxVaryingComponents);
+    checkLimit(cost, "fragment input components", cost.varyingComponents, limits.maxFragmentInputComponents);
+    checkLimit(cost, "vertex output components", cost.vertexOutputComponents, limits.maxVertexOutputComponents);
+    checkLimit(cost, "vertex uniform components", cost.vertexUniformComponents, limits.maxVertexUniformComponents);
+    checkLimit(cost, "fragment uniform components", cost.fragmentUniformComponents, limits.maxFragmentUniformComponents);
+    checkLimit(cost, "samplers", cost.samplers, limits.maxTextureUnits);
+    return cost.problems.empty();
+}
+
+string getCostReport(const ShaderCost &cost) {
+    stringstream report;
+    report << "texture fetches: " << cost.textureFetches << " texels in " << cost.fetchCalls << " calls" << endl;
+    report << "alu ops: ~" << cost.aluOps << endl;
+    report << "samplers: " << cost.samplers << endl;
+    report << "varying components: " << cost.varyingComponents << ", vertex outputs " << cost.vertexOutputComponents << endl;
+    report << "uniform components: vertex " << cost.vertexUniformComponents << ", fragment " << cost.fragmentUniformComponents << endl;
+    if (cost.dynamicLoops) {
+        report << cost.dynamicLoops << " loops without literal bounds counted once" << endl;
+    }
+    for (vector<string>::const_iterator iter=cost.problems.begin();iter!=cost.problems.end();iter++) {
+        report << "over limit: " << *iter << endl;
+    }
+    return report.str();
+}
+
+int getMaxFastBlurRadius(const ShaderLimits &limits) {
+    int radius = 0;
+    while (radius<64) {
+        ShaderCost cost = analyzeShader(getFastBlurVertex(radius+1), getFastBlurFragment(radius+1, 0.2));
+        if (!checkLimits(cost, limits)) {
+            break;
+        }
+        radius++;
+    }
+    return radius;
+}
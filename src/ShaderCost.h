@@ -0,0 +1,43 @@
+//
+//  ShaderCost.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+
+struct ShaderLimits {
+    int maxVaryingComponents;
+    int maxVertexOutputComponents;
+    int maxFragmentInputComponents;
+    int maxVertexUniformComponents;
+    int maxFragmentUniformComponents;
+    int maxTextureUnits;
+};
+
+// static estimate of a program from its sources, per fragment unless noted.
+// loops with literal bounds are unrolled in the counts, other loops count one iteration
+struct ShaderCost {
+    int textureFetches; // texels read, textureGather counts 4
+    int fetchCalls;
+    int aluOps; // arithmetic operators and builtin calls, a rough estimate
+    int samplers;
+    int varyingComponents; // fragment inputs, every vector or array element padded to 4
+    int vertexOutputComponents; // including the 4 of gl_Position
+    int vertexUniformComponents;
+    int fragmentUniformComponents;
+    int dynamicLoops;
+    vector<string> problems; // filled by checkLimits
+};
+
+ShaderLimits getShaderLimits(); // from the current context
+ShaderLimits getMinimumShaderLimits(); // guaranteed by GL 3.2
+
+ShaderCost analyzeShader(const string &vertex,const string &fragment);
+bool checkLimits(ShaderCost &cost,const ShaderLimits &limits);
+string getCostReport(const ShaderCost &cost);
+
+// largest radius whose createFastBlurShader fits the limits, its varyings grow with the radius
+int getMaxFastBlurRadius(const ShaderLimits &limits);
@@ -0,0 +1,425 @@
+//
+//  ShaderReference.cpp
+//  depthBlur
+//
+//
+
+#include "ShaderReference.h"
+#include "Shaders.h"
+
+static const float *getTexel(const ofFloatPixels &pixels,int x,int y) {
+    x = ofClamp(x, 0, pixels.getWidth()-1);
+    y = ofClamp(y, 0, pixels.getHeight()-1);
+    return pixels.getPixels()+(y*pixels.getWidth()+x)*pixels.getNumChannels();
+}
+
+static void setGray(float *texel,float value) {
+    texel[0] = texel[1] = texel[2] = value;
+    texel[3] = 1.0;
+}
+
+static float step(float edge,float x) {
+    return x<edge ? 0.0 : 1.0;
+}
+
+static float smoothstep(float edge0,float edge1,float x) {
+    float t = ofClamp((x-edge0)/(edge1-edge0), 0, 1);
+    return t*t*(3-2*t);
+}
+
+static float *getOutput(ofFloatPixels &dst,int x,int y) {
+    return dst.getPixels()+(y*dst.getWidth()+x)*4;
+}
+
+void referenceDepth(const ofFloatPixels &src,ofFloatPixels &dst,float minEdge,float maxEdge) {
+    dst.allocate(src.getWidth(), src.getHeight(), 4);
+    for (int y=0;y<src.getHeight();y++) {
+        for (int x=0;x<src.getWidth();x++) {
+            float sample = getTexel(src, x, y)[0];
+            float dist = (sample-minEdge)/(maxEdge-minEdge);
+            setGray(getOutput(dst, x, y), (1-dist)*(step(minEdge,sample)-step(maxEdge,sample)));
+        }
+    }
+}
+
+void referenceDepthMask(const ofFloatPixels &src,const ofFloatPixels &bg,ofFloatPixels &dst,float minEdge,float maxEdge,float tolerance) {
+    dst.allocate(src.getWidth(), src.getHeight(), 4);
+    for (int y=0;y<src.getHeight();y++) {
+        for (int x=0;x<src.getWidth();x++) {
+            float c = getTexel(src, x, y)[0];
+            float sample = fabs(c-getTexel(bg, x, y)[0])>tolerance ? c : 0;
+            setGray(getOutput(dst, x, y), step(minEdge,sample)-step(maxEdge,sample));
+        }
+    }
+}
+
+void referenceDepthBackgroundSubtraction(const ofFloatPixels &src,const ofFloatPixels &bg,ofFloatPixels &dst,float tolerance) {
+    dst.allocate(src.getWidth(), src.getHeight(), 4);
+    for (int y=0;y<src.getHeight();y++) {
+        for (int x=0;x<src.getWidth();x++) {
+            float c = getTexel(src, x, y)[0];
+            setGray(getOutput(dst, x, y), fabs(c-getTexel(bg, x, y)[0])>tolerance ? c : 0);
+        }
+    }
+}
+
+void referenceColor2Gray(const ofFloatPixels &src,ofFloatPixels &dst) {
+    dst.allocate(src.getWidth(), src.getHeight(), 4);
+    for (int y=0;y<src.getHeight();y++) {
+        for (int x=0;x<src.getWidth();x++) {
+            const float *c = getTexel(src, x, y);
+            setGray(getOutput(dst, x, y), c[0]*0.299+c[1]*0.587+c[2]*0.114);
+        }
+    }
+}
+
+void referenceThreshold(const ofFloatPixels &src,ofFloatPixels &dst,float edge0,float edge1) {
+    dst.allocate(src.getWidth(), src.getHeight(), 4);
+    for (int y=0;y<src.getHeight();y++) {
+        for (int x=0;x<src.getWidth();x++) {
+            float c = getTexel(src, x, y)[0];
+            setGray(getOutput(dst, x, y), smoothstep(edge0,edge1,c)*c);
+        }
+    }
+}
+
+void referenceMasking(const ofFloatPixels &src,const ofFloatPixels &mask,ofFloatPixels &dst) {
+    dst.allocate(src.getWidth(), src.getHeight(), 4);
+    for (int y=0;y<src.getHeight();y++) {
+        for (int x=0;x<src.getWidth();x++) {
+            const float *c = getTexel(src, x, y);
+            float *out = getOutput(dst, x, y);
+            out[0] = c[0];
+            out[1] = c[1];
+            out[2] = c[2];
+            out[3] = getTexel(mask, x, y)[0];
+        }
+    }
+}
+
+void referenceInverseMasking(const ofFloatPixels &src,const ofFloatPixels &mask,ofFloatPixels &dst) {
+    referenceMasking(src, mask, dst);
+    for (int i=3;i<dst.size();i+=4) {
+        dst[i] = 1-dst[i];
+    }
+}
+
+void referenceScreen(const ofFloatPixels &src0,const ofFloatPixels &src1,ofFloatPixels &dst) {
+    dst.allocate(src0.getWidth(), src0.getHeight(), 4);
+    for (int y=0;y<src0.getHeight();y++) {
+        for (int x=0;x<src0.getWidth();x++) {
+            const float *c0 = getTexel(src0, x, y);
+            const float *c1 = getTexel(src1, x, y);
+            float *out = getOutput(dst, x, y);
+            for (int k=0;k<4;k++) {
+                out[k] = 1-(1-c0[k])*(1-c1[k]);
+            }
+        }
+    }
+}
+
+void referenceBlend(const ofFloatPixels &src0,const ofFloatPixels &src1,ofFloatPixels &dst,float alpha) {
+    dst.allocate(src0.getWidth(), src0.getHeight(), 4);
+    for (int y=0;y<src0.getHeight();y++) {
+        for (int x=0;x<src0.getWidth();x++) {
+            const float *c0 = getTexel(src0, x, y);
+            const float *c1 = getTexel(src1, x, y);
+            float *out = getOutput(dst, x, y);
+            for (int k=0;k<3;k++) {
+                out[k] = c0[k]+(c1[k]-c0[k])*alpha;
+            }
+            out[3] = c0[3];
+        }
+    }
+}
+
+void referenceScreenMultiple(const vector<const ofFloatPixels *> &src,ofFloatPixels &dst,int mask) {
+    dst.allocate(src[0]->getWidth(), src[0]->getHeight(), 4);
+    for (int y=0;y<dst.getHeight();y++) {
+        for (int x=0;x<dst.getWidth();x++) {
+            float *out = getOutput(dst, x, y);
+            float product[3] = {1,1,1};
+            for (int i=0;i<src.size();i++) {
+                if (!(mask & 1<<i)) {
+                    continue;
+                }
+                const float *c = getTexel(*src[i], x, y);
+                for (int k=0;k<3;k++) {
+                    product[k]*=1-c[k];
+                }
+            }
+            for (int k=0;k<3;k++) {
+                out[k] = 1-product[k];
+            }
+            out[3] = 1.0;
+        }
+    }
+}
+
+void referenceHSL(const ofFloatPixels &src,ofFloatPixels &dst,float hue,float sat,float offset) {
+    float rgb[3] = {fabs(hue*6-3)-1,2-fabs(hue*6-2),2-fabs(hue*6-4)};
+    for (int k=0;k<3;k++) {
+        rgb[k] = ofClamp(rgb[k], 0, 1);
+    }
+    
+    dst.allocate(src.getWidth(), src.getHeight(), 4);
+    for (int y=0;y<src.getHeight();y++) {
+        for (int x=0;x<src.getWidth();x++) {
+            float l = getTexel(src, x, y)[0]+offset;
+            float c = (1-fabs(2*l-1))*sat;
+            float *out = getOutput(dst, x, y);
+            for (int k=0;k<3;k++) {
+                out[k] = (rgb[k]-0.5)*c+l;
+            }
+            out[3] = 1.0;
+        }
+    }
+}
+
+void referenceEcho(const ofFloatPixels &src0,const ofFloatPixels &src1,ofFloatPixels &dst,float alpha) {
+    referenceBlend(src0, src1, dst, alpha);
+    for (int i=3;i<dst.size();i+=4) {
+        dst[i] = 1.0;
+    }
+}
+
+void referenceStrobe(const ofFloatPixels &src,const ofFloatPixels &previous,const ofFloatPixels &previousHue,ofFloatPixels &color,ofFloatPixels &hue,int frameNum,int strobeRate,float decay) {
+    bool strobe = frameNum%strobeRate==0;
+    color.allocate(src.getWidth(), src.getHeight(), 4);
+    hue.allocate(src.getWidth(), src.getHeight(), 4);
+    for (int y=0;y<src.getHeight();y++) {
+        for (int x=0;x<src.getWidth();x++) {
+            float c = getTexel(src, x, y)[0];
+            bool on = strobe && c>0;
+            setGray(getOutput(color, x, y), on ? c : getTexel(previous, x, y)[0]*decay);
+            setGray(getOutput(hue, x, y), on ? (frameNum/10%256)/255.0 : getTexel(previousHue, x, y)[0]);
+        }
+    }
+}
+
+void referenceCloud(const ofFloatPixels &src,ofFloatPixels &dst,float minEdge,float maxEdge,float scale) {
+    dst.allocate(src.getWidth(), src.getHeight(), 4);
+    for (int y=0;y<src.getHeight();y++) {
+        for (int x=0;x<src.getWidth();x++) {
+            float sample = getTexel(src, x, y)[0]*scale;
+            float dist = (sample-minEdge)/(maxEdge-minEdge);
+            setGray(getOutput(dst, x, y), (1-dist)*(step(minEdge,sample)-step(maxEdge,sample)));
+        }
+    }
+}
+
+void referenceBorder(const ofFloatPixels &src,ofFloatPixels &dst) {
+    dst.allocate(src.getWidth(), src.getHeight(), 4);
+    for (int y=0;y<src.getHeight();y++) {
+        for (int x=0;x<src.getWidth();x++) {
+            setGray(getOutput(dst, x, y), 1-step(0.5,getTexel(src, x, y)[3]));
+        }
+    }
+}
+
+static void convolve(const ofFloatPixels &src,ofFloatPixels &dst,int radius,double variance,int dx,int dy,int channels) {
+    vector<double> coefs;
+    createCoefficients(radius, variance, coefs);
+    
+    dst.allocate(src.getWidth(), src.getHeight(), 4);
+    for (int y=0;y<src.getHeight();y++) {
+        for (int x=0;x<src.getWidth();x++) {
+            double sum[4] = {0,0,0,0};
+            for (int i=0;i<radius*2+1;i++) {
+                const float *c = getTexel(src, x+(i-radius)*dx, y+(i-radius)*dy);
+                for (int k=0;k<channels;k++) {
+                    sum[k]+=c[k]*coefs[i];
+                }
+            }
+            float *out = getOutput(dst, x, y);
+            for (int k=0;k<4;k++) {
+                out[k] = sum[k];
+            }
+            if (channels<4) {
+                out[3] = 1.0;
+            }
+        }
+    }
+}
+
+void referenceFastBlur(const ofFloatPixels &src,ofFloatPixels &dst,int radius,double variance,int dx,int dy) {
+    convolve(src, dst, radius, variance, dx, dy, 4);
+}
+
+void referenceBlur(const ofFloatPixels &src,ofFloatPixels &dst,int radius,double variance,int dx,int dy) {
+    convolve(src, dst, radius, variance, dx, dy, 3);
+}
+
+void referenceDepthBlur(const ofFloatPixels &src,ofFloatPixels &dst,int radius,double variance,int dx,int dy) {
+    convolve(src, dst, radius, variance, dx, dy, 1);
+    for (int i=0;i<dst.size();i+=4) {
+        setGray(&dst[i], dst[i]);
+    }
+}
+
+void referenceDilation(const ofFloatPixels &src,ofFloatPixels &dst) {
+    dst.allocate(src.getWidth(), src.getHeight(), 4);
+    for (int y=0;y<src.getHeight();y++) {
+        for (int x=0;x<src.getWidth();x++) {
+            float *out = getOutput(dst, x, y);
+            out[0] = out[1] = out[2] = out[3] = 0;
+            for (int j=-1;j<=1;j++) {
+                for (int i=-1;i<=1;i++) {
+                    const float *c = getTexel(src, x+i, y+j);
+                    for (int k=0;k<4;k++) {
+                        out[k] = max(out[k],c[k]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void referenceKuwahara(const ofFloatPixels &src,ofFloatPixels &dst,int radius) {
+    // quadrants in the order of createKuwaharaShader
+    const int x0[4] = {-radius,0,0,-radius};
+    const int y0[4] = {-radius,-radius,0,0};
+    double n = (radius+1)*(radius+1);
+    
+    dst.allocate(src.getWidth(), src.getHeight(), 4);
+    for (int y=0;y<src.getHeight();y++) {
+        for (int x=0;x<src.getWidth();x++) {
+            // relative to the center texel like getKuwaharaFragment, and in double, so the
+            // variances of smooth quadrants do not cancel away
+            const float *center = getTexel(src, x, y);
+            float *out = getOutput(dst, x, y);
+            double minSigma2 = 1e+2;
+            for (int q=0;q<4;q++) {
+                double m[3] = {0,0,0};
+                double s[3] = {0,0,0};
+                for (int j=y0[q];j<=y0[q]+radius;j++) {
+                    for (int i=x0[q];i<=x0[q]+radius;i++) {
+                        const float *c = getTexel(src, x+i, y+j);
+                        for (int k=0;k<3;k++) {
+                            double d = c[k]-center[k];
+                            m[k]+=d;
+                            s[k]+=d*d;
+                        }
+                    }
+                }
+                double sigma2 = 0;
+                for (int k=0;k<3;k++) {
+                    m[k]/=n;
+                    sigma2+=fabs(s[k]/n-m[k]*m[k]);
+                }
+                if (sigma2<minSigma2) {
+                    minSigma2 = sigma2;
+                    out[0] = m[0]+center[0];
+                    out[1] = m[1]+center[1];
+                    out[2] = m[2]+center[2];
+                }
+            }
+            out[3] = center[3];
+        }
+    }
+}
+
+void referenceBilateralGrid(const ofFloatPixels &src,ofFloatPixels &dst,float spatial,float range) {
+    int width = src.getWidth();
+    int height = src.getHeight();
+    int size[3] = {(int)((width-1)/spatial)+2,(int)((height-1)/spatial)+2,(int)(1/range)+2};
+    int cells = size[0]*size[1]*size[2];
+    
+    // (sum of depth, weight) per cell, x fastest
+    vector<float> grid(cells*2,0);
+    vector<float> blurred(cells*2);
+    
+    for (int y=0;y<height;y++) {
+        for (int x=0;x<width;x++) {
+            float d = getTexel(src, x, y)[0];
+            if (d<=0) {
+                continue;
+            }
+            int gx = floor(x/spatial+0.5);
+            int gy = floor(y/spatial+0.5);
+            int gz = floor(d/range+0.5);
+            int i = (gz*size[1]+gy)*size[0]+gx;
+            grid[i*2]+=d;
+            grid[i*2+1]+=1;
+        }
+    }
+    
+    const float w[5] = {1,4,6,4,1};
+    const int stride[3] = {1,size[0],size[0]*size[1]};
+    for (int axis=0;axis<3;axis++) {
+        for (int z=0;z<size[2];z++) {
+            for (int y=0;y<size[1];y++) {
+                for (int x=0;x<size[0];x++) {
+                    int c[3] = {x,y,z};
+                    int i = (z*size[1]+y)*size[0]+x;
+                    float sum[2] = {0,0};
+                    for (int k=-2;k<=2;k++) {
+                        if (c[axis]+k<0 || c[axis]+k>=size[axis]) {
+                            continue;
+                        }
+                        int j = i+k*stride[axis];
+                        sum[0]+=w[k+2]*grid[j*2];
+                        sum[1]+=w[k+2]*grid[j*2+1];
+                    }
+                    blurred[i*2] = sum[0]/16;
+                    blurred[i*2+1] = sum[1]/16;
+                }
+            }
+        }
+        grid.swap(blurred);
+    }
+    
+    dst.allocate(width, height, 4);
+    for (int y=0;y<height;y++) {
+        for (int x=0;x<width;x++) {
+            float d = getTexel(src, x, y)[0];
+            float g[3] = {x/spatial,y/spatial,(float)ofClamp(d/range, 0, size[2]-1)};
+            int c[3];
+            float f[3];
+            for (int k=0;k<3;k++) {
+                c[k] = min((int)floor(g[k]),size[k]-1);
+                f[k] = g[k]-c[k];
+            }
+            
+            float v[2] = {0,0};
+            for (int corner=0;corner<8;corner++) {
+                int o[3] = {corner&1,(corner>>1)&1,(corner>>2)&1};
+                float weight = 1;
+                int q[3];
+                for (int k=0;k<3;k++) {
+                    weight*=o[k] ? f[k] : 1-f[k];
+                    q[k] = min(c[k]+o[k],size[k]-1);
+                }
+                int i = (q[2]*size[1]+q[1])*size[0]+q[0];
+                v[0]+=weight*grid[i*2];
+                v[1]+=weight*grid[i*2+1];
+            }
+            setGray(getOutput(dst, x, y), v[1]>1e-4 ? v[0]/v[1] : d);
+        }
+    }
+}
+
+float getMaxDifference(const ofFloatPixels &pixels0,const ofFloatPixels &pixels1) {
+    if (pixels0.size()!=pixels1.size()) {
+        ofLogError("ShaderReference") << "getMaxDifference: size mismatch";
+        return numeric_limits<float>::max();
+    }
+    
+    float difference = 0;
+    for (int i=0;i<pixels0.size();i++) {
+        difference = max(difference,(float)fabs(pixels0[i]-pixels1[i]));
+    }
+    return difference;
+}
+
+float compareToReference(ofTexture &texture,const ofFloatPixels &reference) {
+    ofFloatPixels pixels;
+    pixels.allocate(texture.getWidth(), texture.getHeight(), 4);
+    
+    ofTextureData &data = texture.getTextureData();
+    glBindTexture(data.textureTarget, data.textureID);
+    glGetTexImage(data.textureTarget, 0, GL_RGBA, GL_FLOAT, pixels.getPixels());
+    glBindTexture(data.textureTarget, 0);
+    
+    return getMaxDifference(pixels, reference);
+}
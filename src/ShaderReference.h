@@ -0,0 +1,40 @@
+//
+//  ShaderReference.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+
+// cpu implementations of the effects in Shaders.h working on 4 channel float pixels.
+// sampling is nearest with clamp to edge, blur and dilation step a whole texel in (dx,dy)
+
+void referenceDepth(const ofFloatPixels &src,ofFloatPixels &dst,float minEdge,float maxEdge);
+void referenceDepthMask(const ofFloatPixels &src,const ofFloatPixels &bg,ofFloatPixels &dst,float minEdge,float maxEdge,float tolerance);
+void referenceDepthBackgroundSubtraction(const ofFloatPixels &src,const ofFloatPixels &bg,ofFloatPixels &dst,float tolerance);
+void referenceColor2Gray(const ofFloatPixels &src,ofFloatPixels &dst);
+void referenceThreshold(const ofFloatPixels &src,ofFloatPixels &dst,float edge0,float edge1);
+void referenceMasking(const ofFloatPixels &src,const ofFloatPixels &mask,ofFloatPixels &dst);
+void referenceInverseMasking(const ofFloatPixels &src,const ofFloatPixels &mask,ofFloatPixels &dst);
+void referenceScreen(const ofFloatPixels &src0,const ofFloatPixels &src1,ofFloatPixels &dst);
+void referenceBlend(const ofFloatPixels &src0,const ofFloatPixels &src1,ofFloatPixels &dst,float alpha);
+void referenceScreenMultiple(const vector<const ofFloatPixels *> &src,ofFloatPixels &dst,int mask); // 5 sources, bit i enables src[i]
+void referenceHSL(const ofFloatPixels &src,ofFloatPixels &dst,float hue,float sat,float offset);
+void referenceEcho(const ofFloatPixels &src0,const ofFloatPixels &src1,ofFloatPixels &dst,float alpha);
+// the two outputs of createStrobeShader, previous and previousHue are its last outputs
+void referenceStrobe(const ofFloatPixels &src,const ofFloatPixels &previous,const ofFloatPixels &previousHue,ofFloatPixels &color,ofFloatPixels &hue,int frameNum,int strobeRate,float decay);
+// src holds the clip space z createCloudShader sees at each texel
+void referenceCloud(const ofFloatPixels &src,ofFloatPixels &dst,float minEdge,float maxEdge,float scale);
+void referenceBorder(const ofFloatPixels &src,ofFloatPixels &dst);
+void referenceFastBlur(const ofFloatPixels &src,ofFloatPixels &dst,int radius,double variance,int dx,int dy);
+void referenceBlur(const ofFloatPixels &src,ofFloatPixels &dst,int radius,double variance,int dx,int dy);
+void referenceDepthBlur(const ofFloatPixels &src,ofFloatPixels &dst,int radius,double variance,int dx,int dy);
+void referenceDilation(const ofFloatPixels &src,ofFloatPixels &dst);
+void referenceKuwahara(const ofFloatPixels &src,ofFloatPixels &dst,int radius);
+void referenceBilateralGrid(const ofFloatPixels &src,ofFloatPixels &dst,float spatial,float range);
+
+// largest per channel difference, the texture is read back as float rgba
+float getMaxDifference(const ofFloatPixels &pixels0,const ofFloatPixels &pixels1);
+float compareToReference(ofTexture &texture,const ofFloatPixels &reference);
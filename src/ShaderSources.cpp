@@ -0,0 +1,99 @@
+//
+//  ShaderSources.cpp
+//  depthBlur
+//
+//
+
+#include "ShaderSources.h"
+#include "Shaders.h"
+
+struct ShaderSourceKey {
+    ShaderSourceType type;
+    int radius;
+    double variance;
+    int option;
+    
+    bool operator<(const ShaderSourceKey &key) const {
+        if (type!=key.type) {
+            return type<key.type;
+        }
+        if (radius!=key.radius) {
+            return radius<key.radius;
+        }
+        if (variance!=key.variance) {
+            return variance<key.variance;
+        }
+        return option<key.option;
+    }
+};
+
+static map<ShaderSourceKey,string> &getSources() {
+    static map<ShaderSourceKey,string> sources;
+    return sources;
+}
+
+static string generateSource(const ShaderSourceKey &key) {
+    switch (key.type) {
+        case SHADER_SOURCE_FAST_BLUR_VERTEX:
+            return getFastBlurVertex(key.radius);
+        case SHADER_SOURCE_FAST_BLUR:
+            return getFastBlurFragment(key.radius, key.variance);
+        case SHADER_SOURCE_BLUR:
+            return getBlurFragment(key.radius, key.variance);
+        case SHADER_SOURCE_DEPTH_BLUR:
+            return getDepthBlurFragment(key.radius, key.variance, (ShaderFormat)key.option);
+        case SHADER_SOURCE_VAR_DEPTH_BLUR:
+            return getVarDepthBlurFragment(key.radius, key.variance);
+        case SHADER_SOURCE_KUWAHARA:
+            return getKuwaharaFragment(key.radius, key.option);
+    }
+    return "";
+}
+
+string getShaderSource(ShaderSourceType type,int radius,double variance,int option) {
+    ShaderSourceKey key;
+    key.type = type;
+    key.radius = radius;
+    // parameters a source does not use stay out of the key
+    key.variance = type==SHADER_SOURCE_FAST_BLUR_VERTEX || type==SHADER_SOURCE_KUWAHARA ? 0 : variance;
+    key.option = type==SHADER_SOURCE_DEPTH_BLUR || type==SHADER_SOURCE_KUWAHARA ? option : 0;
+    
+    map<ShaderSourceKey,string> &sources = getSources();
+    map<ShaderSourceKey,string>::iterator iter = sources.find(key);
+    if (iter!=sources.end()) {
+        return iter->second;
+    }
+    if (sources.size()>=MAX_SHADER_SOURCES) {
+        ofLogWarning("ShaderSources") << "more than " << MAX_SHADER_SOURCES << " sources, not caching type " << type << " radius " << radius;
+        return generateSource(key);
+    }
+    return sources.insert(make_pair(key, generateSource(key))).first->second;
+}
+
+void declareShaderSources(ShaderSourceType type,int minRadius,int maxRadius,double variance,int option) {
+    for (int radius=minRadius;radius<=maxRadius;radius++) {
+        getShaderSource(type, radius, variance, option);
+    }
+}
+
+int getNumShaderSources() {
+    return getSources().size();
+}
+
+int getShaderSourceBytes() {
+    int bytes = 0;
+    map<ShaderSourceKey,string> &sources = getSources();
+    for (map<ShaderSourceKey,string>::iterator iter=sources.begin();iter!=sources.end();iter++) {
+        bytes += iter->second.size();
+    }
+    return bytes;
+}
+
+unsigned int getSourceHash(const string &source) {
+    unsigned int hash = 2166136261u;
+    for (string::const_iterator iter=source.begin();iter!=source.end();iter++) {
+        hash ^= (unsigned char)*iter;
+        hash *= 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,32 @@
+//
+//  ShaderSources.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+
+enum ShaderSourceType {
+    SHADER_SOURCE_FAST_BLUR_VERTEX, // radius
+    SHADER_SOURCE_FAST_BLUR, // radius, variance
+    SHADER_SOURCE_BLUR, // radius, variance
+    SHADER_SOURCE_DEPTH_BLUR, // radius, variance, option is the ShaderFormat
+    SHADER_SOURCE_VAR_DEPTH_BLUR, // radius, variance
+    SHADER_SOURCE_KUWAHARA // radius, option is luma
+};
+
+#define MAX_SHADER_SOURCES 256
+
+// generated sources built once per parameters and kept for the lifetime of the app, so
+// creating a shader again skips the generation and equal parameters give the same string.
+// past MAX_SHADER_SOURCES entries a source is generated on every call without caching.
+// declare the radii used by a show at startup to move the generation out of the frame.
+// render thread only
+string getShaderSource(ShaderSourceType type,int radius,double variance=0,int option=0);
+void declareShaderSources(ShaderSourceType type,int minRadius,int maxRadius,double variance=0,int option=0);
+int getNumShaderSources();
+int getShaderSourceBytes();
+
+unsigned int getSourceHash(const string &source); // FNV-1a, stable across runs
@@ -7,18 +7,26 @@
 //
 
 #include "Shaders.h"
+#include "ShaderSources.h"
 
 #define STRINGIFY(A) #A
 
-void createSimpleShader(ofShader &shader,string fragment) {
+void createShader(ofShader &shader,const string &vertex,const string &fragment) {
+    shader.setupShaderFromSource(GL_VERTEX_SHADER, vertex);
+    shader.setupShaderFromSource(GL_FRAGMENT_SHADER, fragment);
+    shader.bindDefaults();
+    shader.linkProgram();
+}
+
+void createSimpleShader(ofShader &shader,const string &fragment) {
     shader.setupShaderFromSource(GL_VERTEX_SHADER, getSimpleVertex());
     shader.setupShaderFromSource(GL_FRAGMENT_SHADER, fragment);
     shader.bindDefaults();
     shader.linkProgram();
 }
 
-string getSimpleVertex() {
-    return STRINGIFY(
+const string &getSimpleVertex() {
+    static const string source = STRINGIFY(
                      \n#version 150\n
                      uniform mat4 modelViewProjectionMatrix;
                      in vec4 position;
@@ -31,98 +39,268 @@ string getSimpleVertex() {
                          gl_Position = modelViewProjectionMatrix * position;
                      }
                      );
+    return source;
+}
+
+const string &getQuadVertex() {
+    static const string source = STRINGIFY(
+                     \n#version 150\n
+                     void main() {
+                         vec2 p = vec2((gl_VertexID<<1)&2, gl_VertexID&2);
+                         gl_Position = vec4(p*2.0-1.0,0.0,1.0);
+                     }
+                     );
+    return source;
 }
 
-void createDepthShader(ofShader &shader) {
+void createQuadShader(ofShader &shader,const string &fragment) {
+    createShader(shader,getQuadVertex(),fragment);
+}
+
+GLuint createTargetTexture(int width,int height,GLint internalFormat,GLenum format,int levels) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    for (int i=0;i<levels;i++) {
+        glTexImage2D(GL_TEXTURE_2D, i, internalFormat, max(width>>i,1), max(height>>i,1), 0, format, GL_FLOAT, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels-1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+GLint getFormatInternal(ShaderFormat format) {
+    switch (format) {
+        case SHADER_FORMAT_R8:
+            return GL_R8;
+        case SHADER_FORMAT_R16F:
+            return GL_R16F;
+        case SHADER_FORMAT_RG16F:
+            return GL_RG16F;
+        default:
+            return GL_RGBA8;
+    }
+}
+
+int getFormatChannels(ShaderFormat format) {
+    switch (format) {
+        case SHADER_FORMAT_R8:
+        case SHADER_FORMAT_R16F:
+            return 1;
+        case SHADER_FORMAT_RG16F:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+int getFormatBytes(ShaderFormat format) {
+    switch (format) {
+        case SHADER_FORMAT_R8:
+            return 1;
+        case SHADER_FORMAT_R16F:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+string getFormatName(ShaderFormat format) {
+    switch (format) {
+        case SHADER_FORMAT_R8:
+            return "R8";
+        case SHADER_FORMAT_R16F:
+            return "R16F";
+        case SHADER_FORMAT_RG16F:
+            return "RG16F";
+        default:
+            return "RGBA8";
+    }
+}
+
+string getFragmentOutput(ShaderFormat format) {
+    switch (getFormatChannels(format)) {
+        case 1:
+            return "out float fragColor;";
+        case 2:
+            return "out vec2 fragColor;";
+        default:
+            return "out vec4 fragColor;";
+    }
+}
+
+string getFragmentAssignment(ShaderFormat format,const string &value) {
+    switch (getFormatChannels(format)) {
+        case 1:
+            return "fragColor = " + value + ";";
+        case 2:
+            return "fragColor = vec2(" + value + ",1.0);"; // gray + alpha
+        default:
+            return "fragColor = vec4(vec3(" + value + "),1.0);";
+    }
+}
+
+void allocateTarget(ofFbo &fbo,int width,int height,ShaderFormat format) {
+    fbo.allocate(width, height, getFormatInternal(format));
+    
+    if (getFormatChannels(format)<4) {
+        // downstream shaders keep reading .rgb / .a of a gray image
+        GLint swizzle[4] = {GL_RED,GL_RED,GL_RED,getFormatChannels(format)==2 ? GL_GREEN : GL_ONE};
+        ofTextureData &data = fbo.getTextureReference().getTextureData();
+        glBindTexture(data.textureTarget, data.textureID);
+        glTexParameteriv(data.textureTarget, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        glBindTexture(data.textureTarget, 0);
+    }
+}
+
+string getChainMemoryReport(const vector<ShaderFormat> &formats,int width,int height) {
+    stringstream report;
+    
+    size_t pixels = width*height;
+    size_t total = 0;
+    size_t rgbaTotal = 0;
+    
+    report << "pass\tformat\tmemory\tbandwidth/frame" << endl;
+    for (int i=0;i<formats.size();i++) {
+        size_t bytes = pixels*getFormatBytes(formats[i]);
+        // each target is written once and read once by the next pass
+        report << i << "\t" << getFormatName(formats[i]) << "\t" << bytes/1024 << " KB\t" << 2*bytes/1024 << " KB" << endl;
+        total+=bytes;
+        rgbaTotal+=pixels*getFormatBytes(SHADER_FORMAT_RGBA8);
+    }
+    report << "total\t\t" << total/1024 << " KB\t" << 2*total/1024 << " KB";
+    report << " (RGBA8: " << rgbaTotal/1024 << " KB\t" << 2*rgbaTotal/1024 << " KB)" << endl;
+    
+    return report.str();
+}
+
+// edges are either uniforms or read from the 1x1 edges texture of DepthStatistics
+static string getDepthEdges(bool edgesTexture) {
+    if (edgesTexture) {
+        return "uniform sampler2D edgesTex;\n"
+               "#define minEdge texelFetch(edgesTex,ivec2(0),0).r\n"
+               "#define maxEdge texelFetch(edgesTex,ivec2(0),0).g\n";
+    }
+    return "uniform float minEdge;\nuniform float maxEdge;\n";
+}
+
+static void createDepthShaderImpl(ofShader &shader,ShaderFormat format,bool edgesTexture) {
     
     
-    string fragment = STRINGIFY(
+    stringstream fragment;
+    fragment << STRINGIFY(
                                  \n#version 150\n
                                  uniform sampler2D tex0;
-                                 uniform float minEdge;
-                                 uniform float maxEdge;
-                                 
+                                 );
+    
+    fragment << getDepthEdges(edgesTexture);
+    
+    fragment << STRINGIFY(
                                  in vec2 texCoordVarying;
-                                 out vec4 fragColor;
-                                 
+                                 );
+    
+    fragment << getFragmentOutput(format);
+    
+    fragment << STRINGIFY(
                                  void main(void) {
                                      float sample = texture(tex0,texCoordVarying).r;
                                      float dist = (sample-minEdge)/(maxEdge-minEdge);
                                      float color = (1-dist)*(step(minEdge,sample)-step(maxEdge,sample));
-                                     fragColor = vec4(vec3(color),1.0);
-                                     
-                                 }
-                                 
                                  );
     
+    fragment << getFragmentAssignment(format, "color") << "}";
     
-    
-    createSimpleShader(shader,fragment);
+    createSimpleShader(shader,fragment.str());
+}
+
+void createDepthShader(ofShader &shader,ShaderFormat format) {
+    createDepthShaderImpl(shader,format,false);
+}
+
+void createAutoDepthShader(ofShader &shader,ShaderFormat format) {
+    createDepthShaderImpl(shader,format,true);
 }
 
 
-void createDepthMaskShader(ofShader &shader) {
+static string getDepthMaskFragment(ShaderFormat format,bool edgesTexture) {
     
     
-    string fragment = STRINGIFY(
+    stringstream fragment;
+    fragment << STRINGIFY(
                                 \n#version 150\n
                                 uniform sampler2D tex0;
                                 uniform sampler2D bgTex;
-                                uniform float minEdge;
-                                uniform float maxEdge;
                                 uniform float tolerance;
-                                
+                                );
+    
+    fragment << getDepthEdges(edgesTexture);
+    
+    fragment << STRINGIFY(
                                 in vec2 texCoordVarying;
-                                out vec4 fragColor;
-                                
+                                );
+    
+    fragment << getFragmentOutput(format);
+    
+    fragment << STRINGIFY(
                                 void main(void) {
                                     float c = texture(tex0,texCoordVarying).r;
                                     float bg = texture(bgTex,texCoordVarying).r;
                                     float sample = mix(0,c,abs(c-bg)>tolerance);
                                     float dist = (sample-minEdge)/(maxEdge-minEdge);
                                     float color = step(minEdge,sample)-step(maxEdge,sample);
-                                    fragColor = vec4(vec3(color),1.0);
-                                    
-                                }
-                                
                                 );
     
+    fragment << getFragmentAssignment(format, "color") << "}";
     
-    
-    createSimpleShader(shader,fragment);
+    return fragment.str();
+}
+
+string getDepthMaskFragment(ShaderFormat format) {
+    return getDepthMaskFragment(format,false);
+}
+
+void createDepthMaskShader(ofShader &shader,ShaderFormat format) {
+    createSimpleShader(shader,getDepthMaskFragment(format,false));
+}
+
+void createAutoDepthMaskShader(ofShader &shader,ShaderFormat format) {
+    createSimpleShader(shader,getDepthMaskFragment(format,true));
 }
 
 
-void createDepthBackgroundSubtractionShader(ofShader &shader) {
-    string fragment = STRINGIFY(
+void createDepthBackgroundSubtractionShader(ofShader &shader,ShaderFormat format) {
+    stringstream fragment;
+    fragment << STRINGIFY(
                                 \n#version 150\n
                                 uniform sampler2D tex0;
                                 uniform sampler2D bgTex;
                                 uniform float tolerance;
                                 
                                 in vec2 texCoordVarying;
-                                out vec4 fragColor;
-                                
+                                );
+    
+    fragment << getFragmentOutput(format);
+    
+    fragment << STRINGIFY(
                                 void main(void) {
                                     float c = texture(tex0,texCoordVarying).r;
                                     float bg = texture(bgTex,texCoordVarying).r;
                                     bool mask = abs(c-bg)>tolerance;
-                                
-                                    fragColor = vec4(vec3(mix(0,c,mask)),1.0);
-                                    //fragColor = vec4(vec3(c-texture(bgTex,texCoordVarying).r),1.0);
-                                    //fragColor = vec4(vec3(bg),1.0);
-                                }
-                                
+                                    float color = mix(0,c,mask);
                                 );
     
+    fragment << getFragmentAssignment(format, "color") << "}";
     
-    
-    createSimpleShader(shader,fragment);
+    createSimpleShader(shader,fragment.str());
 
 }
 
-void createMaskingShader(ofShader &shader) {
-    string fragment = STRINGIFY(
+const string &getMaskingFragment() {
+    static const string source = STRINGIFY(
                                 \n#version 150\n
                                 uniform sampler2D tex0;
                                 uniform sampler2D maskTex;
@@ -138,14 +316,15 @@ void createMaskingShader(ofShader &shader) {
                                 }
                                 
                                 );
-    
-    
-    
-    createSimpleShader(shader,fragment);
+    return source;
+}
+
+void createMaskingShader(ofShader &shader) {
+    createSimpleShader(shader,getMaskingFragment());
 }
 
 void createInverseMaskingShader(ofShader &shader) {
-    string fragment = STRINGIFY(
+    static const string fragment = STRINGIFY(
                                 \n#version 150\n
                                 uniform sampler2D tex0;
                                 uniform sampler2D maskTex;
@@ -167,48 +346,34 @@ void createInverseMaskingShader(ofShader &shader) {
     createSimpleShader(shader,fragment);
 }
 
-void createColor2GrayShader(ofShader &shader) {
+string getColor2GrayFragment(ShaderFormat format) {
     
-    string fragment = STRINGIFY(
+    stringstream fragment;
+    fragment << STRINGIFY(
                                 \n#version 150\n
                                 uniform sampler2D tex0;
                                 
                                 
                                 in vec2 texCoordVarying;
-                                out vec4 fragColor;
-                                
-                                
-                                
-                                void main(void) {
-                                    fragColor = vec4(vec3(dot(texture(tex0,texCoordVarying).rgb,vec3(0.299, 0.587, 0.114))),1.0);
-                                    
-                                }
-                                
                                 );
     
+    fragment << getFragmentOutput(format);
+    
+    fragment << STRINGIFY(
+                                void main(void) {
+                                    float gray = dot(texture(tex0,texCoordVarying).rgb,vec3(0.299, 0.587, 0.114));
+                                );
     
+    fragment << getFragmentAssignment(format, "gray") << "}";
     
-    createSimpleShader(shader,fragment);
+    return fragment.str();
 }
 
-void createFastBlurShader(ofShader &shader,int radius,double variance) {
-    
-    vector<double> coefs;
-    double sum =0;
-    
-    for (int i=0; i<radius*2+1; i++) {
-        double x = ofMap(i, 0, radius - 1, -1, 1);
-        double y = (1. / sqrt(TWO_PI * variance)) * exp(-(x * x) / (2 * variance));
-        sum+=y;
-        coefs.push_back(y);
-    }
-    
-    for(vector<double>::iterator iter=coefs.begin();iter!=coefs.end();iter++) {
-        *iter/=sum;
-        
-    }
-    
-    
+void createColor2GrayShader(ofShader &shader,ShaderFormat format) {
+    createSimpleShader(shader,getColor2GrayFragment(format));
+}
+
+string getFastBlurVertex(int radius) {
     
     stringstream blurVert;
     blurVert <<  STRINGIFY(
@@ -240,10 +405,16 @@ void createFastBlurShader(ofShader &shader,int radius,double variance) {
     
     blurVert << "}" ;
     
+    return blurVert.str();
+}
+
+string getFastBlurFragment(int radius,double variance) {
     
-    
+    vector<double> coefs;
+    createCoefficients(radius,variance,coefs);
     
     stringstream blurFrag;
+    blurFrag.imbue(locale::classic());
     blurFrag << STRINGIFY(
                           \n#version 150\n
                           uniform sampler2D tex0;
@@ -271,12 +442,11 @@ void createFastBlurShader(ofShader &shader,int radius,double variance) {
     
     blurFrag << "}";
     
-    shader.setupShaderFromSource(GL_VERTEX_SHADER, blurVert.str());
-    shader.setupShaderFromSource(GL_FRAGMENT_SHADER, blurFrag.str());
-    shader.bindDefaults();
-    shader.linkProgram();
-    
-    
+    return blurFrag.str();
+}
+
+void createFastBlurShader(ofShader &shader,int radius,double variance) {
+    createShader(shader, getShaderSource(SHADER_SOURCE_FAST_BLUR_VERTEX, radius), getShaderSource(SHADER_SOURCE_FAST_BLUR, radius, variance));
 }
 
 void createCoefficients(int radius,double variance,vector<double> &coefs) {
@@ -296,13 +466,14 @@ void createCoefficients(int radius,double variance,vector<double> &coefs) {
     }
 }
 
-void createDepthBlurShader(ofShader &shader,int radius,double variance) {
+string getDepthBlurFragment(int radius,double variance,ShaderFormat format) {
     
     vector<double> coefs;
     createCoefficients(radius,variance,coefs);
     
     
     stringstream blurFrag;
+    blurFrag.imbue(locale::classic());
     blurFrag << STRINGIFY(
                           \n#version 150\n
                           uniform sampler2D tex0;
@@ -310,14 +481,11 @@ void createDepthBlurShader(ofShader &shader,int radius,double variance) {
                           uniform vec2 dir;
                           );
     
+    blurFrag << getFragmentOutput(format);
     
     blurFrag <<  STRINGIFY(
                            
                            
-                           
-                           out vec4 fragColor;
-                           
-                           
                            void main(void)
                            );
     
@@ -328,24 +496,25 @@ void createDepthBlurShader(ofShader &shader,int radius,double variance) {
         blurFrag << "color += texture(tex0,texCoordVarying + " << i-radius << " * dir).r*" << coefs[i] << ";";
     }
     
-    blurFrag << "fragColor=vec4(vec3(color),1.0);}";
+    blurFrag << getFragmentAssignment(format, "color") << "}";
     
 //    cout << blurFrag.str() << endl;
     
-    createSimpleShader(shader,blurFrag.str());
-    
-    
-    
-    
+    return blurFrag.str();
 }
 
-void createBlurShader(ofShader &shader,int radius,double variance) {
+void createDepthBlurShader(ofShader &shader,int radius,double variance,ShaderFormat format) {
+    createSimpleShader(shader, getShaderSource(SHADER_SOURCE_DEPTH_BLUR, radius, variance, format));
+}
+
+string getBlurFragment(int radius,double variance) {
     
     vector<double> coefs;
     createCoefficients(radius,variance,coefs);
     
     
     stringstream blurFrag;
+    blurFrag.imbue(locale::classic());
     blurFrag << STRINGIFY(
                           \n#version 150\n
                           uniform sampler2D tex0;
@@ -366,32 +535,23 @@ void createBlurShader(ofShader &shader,int radius,double variance) {
     blurFrag << "}";
     
     
-    createSimpleShader(shader,blurFrag.str());
-    
-    
+    return blurFrag.str();
 }
 
+void createBlurShader(ofShader &shader,int radius,double variance) {
+    createSimpleShader(shader, getShaderSource(SHADER_SOURCE_BLUR, radius, variance));
+}
 
-void createVarDepthBlurShader(ofShader &shader,int radius,double variance) {
+
+string getVarDepthBlurFragment(int radius,double variance) {
     
     vector<double> coefs;
-    double sum =0;
-    
-    for (int i=0; i<radius*2+1; i++) {
-        double x = ofMap(i, 0, radius - 1, -1, 1);
-        double y = (1. / sqrt(TWO_PI * variance)) * exp(-(x * x) / (2 * variance));
-        sum+=y;
-        coefs.push_back(y);
-    }
-    
-    for(vector<double>::iterator iter=coefs.begin();iter!=coefs.end();iter++) {
-        *iter/=sum;
-        
-    }
+    createCoefficients(radius,variance,coefs);
     
     
     
     stringstream blurFrag;
+    blurFrag.imbue(locale::classic());
     blurFrag << STRINGIFY(
                           \n#version 150\n
                           uniform sampler2D tex0;
@@ -422,45 +582,44 @@ void createVarDepthBlurShader(ofShader &shader,int radius,double variance) {
     
     blurFrag << "}";
     
-    createSimpleShader(shader,blurFrag.str());
-    
-    
+    return blurFrag.str();
+}
+
+void createVarDepthBlurShader(ofShader &shader,int radius,double variance) {
+    createSimpleShader(shader, getShaderSource(SHADER_SOURCE_VAR_DEPTH_BLUR, radius, variance));
 }
 
 
-void createThresholdShader(ofShader &shader) {
+void createThresholdShader(ofShader &shader,ShaderFormat format) {
     
-    string fragment = STRINGIFY(
+    stringstream fragment;
+    fragment << STRINGIFY(
                                 \n#version 150\n
                                 uniform sampler2D tex0;
                                 uniform float edge0;
                                 uniform float edge1;
                                 
                                 in vec2 texCoordVarying;
-                                out vec4 fragColor;
-                                
-                               
-                                
+                                );
+    
+    fragment << getFragmentOutput(format);
+    
+    fragment << STRINGIFY(
                                 void main(void) {
                                     float c = texture(tex0,texCoordVarying).r;
-                                    
-                                    fragColor = vec4(vec3(smoothstep(edge0,edge1,c)*c),1.0);
-//                                    fragColor = vec4(vec3(texture(tex0,texCoordVarying).r),1.0);
-                                    
-                                }
-                                
+                                    float color = smoothstep(edge0,edge1,c)*c;
                                 );
     
+    fragment << getFragmentAssignment(format, "color") << "}";
     
-    
-    createSimpleShader(shader,fragment);
+    createSimpleShader(shader,fragment.str());
 
 }
 
 void createScreenShader(ofShader &shader) {
     
     
-    string fragment = STRINGIFY(
+    static const string fragment = STRINGIFY(
                                 \n#version 150\n
                                 uniform sampler2D tex0;
                                 uniform sampler2D tex1;
@@ -484,7 +643,7 @@ void createScreenShader(ofShader &shader) {
 }
 
 void createBlendShader(ofShader &shader) {
-    string fragment = STRINGIFY(
+    static const string fragment = STRINGIFY(
                                 \n#version 150\n
                                 uniform sampler2D tex0;
                                 uniform sampler2D tex1;
@@ -508,7 +667,7 @@ void createBlendShader(ofShader &shader) {
 }
 
 void createScreenMultipleShader(ofShader &shader) {
-    string fragment = STRINGIFY(
+    static const string fragment = STRINGIFY(
                                 \n#version 150\n
                                 uniform sampler2D tex0;
                                 uniform sampler2D tex1;
@@ -544,7 +703,7 @@ void createScreenMultipleShader(ofShader &shader) {
 void createHSLShader(ofShader &shader) {
     
     
-    string fragment = STRINGIFY(
+    static const string fragment = STRINGIFY(
                                 \n#version 150\n
                                 uniform sampler2D tex0;
                                 uniform float hue;
@@ -579,7 +738,7 @@ void createHSLShader(ofShader &shader) {
 
 void createEchoShader(ofShader &shader) {
     
-    string fragment = STRINGIFY(
+    static const string fragment = STRINGIFY(
                                 \n#version 150\n
                                 uniform sampler2D tex0;
                                 uniform sampler2D tex1;
@@ -602,7 +761,7 @@ void createEchoShader(ofShader &shader) {
 }
 
 void createStrobeShader(ofShader &shader) {
-    string fragment = STRINGIFY(
+    static const string fragment = STRINGIFY(
                                 \n#version 150\n
                                 \n#extension GL_ARB_explicit_attrib_location : enable\n
                                 uniform sampler2D tex0;
@@ -641,7 +800,7 @@ void createStrobeShader(ofShader &shader) {
 }
 
 void createCloudShader(ofShader &shader) {
-    string vertex = STRINGIFY(
+    static const string vertex = STRINGIFY(
                               \n#version 150\n
                               uniform mat4 modelViewProjectionMatrix;
                               in vec4 position;
@@ -655,7 +814,7 @@ void createCloudShader(ofShader &shader) {
                               );
 
 
-    string fragment = STRINGIFY(
+    static const string fragment = STRINGIFY(
                                 \n#version 150\n
                                 
                                 uniform float minEdge;
@@ -690,7 +849,7 @@ void createCloudShader(ofShader &shader) {
 
 
 void createBorderShader(ofShader &shader) {
-    string fragment = STRINGIFY(
+    static const string fragment = STRINGIFY(
                                       \n#version 150\n
                                       uniform sampler2D tex0;
                                       in vec2 texCoordVarying;
@@ -707,7 +866,7 @@ void createBorderShader(ofShader &shader) {
 }
 
 void createDilationShader(ofShader &shader) {
-    string fragment = STRINGIFY(
+    static const string fragment = STRINGIFY(
                                         \n#version 150\n
                                         
                                         uniform sampler2D tex0;
@@ -734,8 +893,87 @@ void createDilationShader(ofShader &shader) {
     createSimpleShader(shader,fragment);
 }
 
-void createHalftoneShader(ofShader &shader) {
-    string fragment = STRINGIFY(
+// effects of the signed distance of DistanceField (pixels, negative inside the mask)
+
+void createDistanceOutlineShader(ofShader &shader) {
+    static const string fragment = STRINGIFY(
+                                \n#version 150\n
+                                uniform sampler2D distTex;
+                                uniform float thickness;
+                                in vec2 texCoordVarying;
+                                
+                                out vec4 fragColor;
+                                
+                                void main(void)
+                                {
+                                    float d = texture(distTex,texCoordVarying).r;
+                                    float outline = step(0.5,d)*(1.0-smoothstep(thickness-0.5,thickness+0.5,d));
+                                    fragColor = vec4(vec3(outline),1.0);
+                                }
+                                );
+    
+    createSimpleShader(shader,fragment);
+}
+
+void createDistanceDilationShader(ofShader &shader) {
+    static const string fragment = STRINGIFY(
+                                \n#version 150\n
+                                uniform sampler2D distTex;
+                                uniform float radius;
+                                in vec2 texCoordVarying;
+                                
+                                out vec4 fragColor;
+                                
+                                void main(void)
+                                {
+                                    float d = texture(distTex,texCoordVarying).r;
+                                    fragColor = vec4(vec3(1.0-smoothstep(radius-0.5,radius+0.5,d)),1.0);
+                                }
+                                );
+    
+    createSimpleShader(shader,fragment);
+}
+
+void createDistanceErosionShader(ofShader &shader) {
+    static const string fragment = STRINGIFY(
+                                \n#version 150\n
+                                uniform sampler2D distTex;
+                                uniform float radius;
+                                in vec2 texCoordVarying;
+                                
+                                out vec4 fragColor;
+                                
+                                void main(void)
+                                {
+                                    float d = texture(distTex,texCoordVarying).r;
+                                    fragColor = vec4(vec3(1.0-smoothstep(-radius-0.5,-radius+0.5,d)),1.0);
+                                }
+                                );
+    
+    createSimpleShader(shader,fragment);
+}
+
+void createDistanceGlowShader(ofShader &shader) {
+    static const string fragment = STRINGIFY(
+                                \n#version 150\n
+                                uniform sampler2D distTex;
+                                uniform float radius;
+                                in vec2 texCoordVarying;
+                                
+                                out vec4 fragColor;
+                                
+                                void main(void)
+                                {
+                                    float d = max(texture(distTex,texCoordVarying).r,0.0);
+                                    fragColor = vec4(vec3(exp(-d*d/(2.0*radius*radius))),1.0);
+                                }
+                                );
+    
+    createSimpleShader(shader,fragment);
+}
+
+const string &getHalftoneFragment() {
+    static const string source = STRINGIFY(
                                 \n#version 150\n
                                 uniform sampler2D src_tex_unit0;
                                 uniform float rotation;
@@ -806,13 +1044,15 @@ void createHalftoneShader(ofShader &shader) {
                                 }
 
                                 );
-    
-    
-    createSimpleShader(shader,fragment);
+    return source;
+}
+
+void createHalftoneShader(ofShader &shader) {
+    createSimpleShader(shader,getHalftoneFragment());
 }
 
 void createKuwaharaShader(ofShader &shader) {
-    string fragment = STRINGIFY(
+    static const string fragment = STRINGIFY(
                                 \n#version 150\n
                                 uniform sampler2D inputImageTexture;
                                 
@@ -914,7 +1154,7 @@ void createKuwaharaShader(ofShader &shader) {
 }
 
 void createKuwahara3Shader(ofShader &shader) {
-    string fragment = STRINGIFY(
+    static const string fragment = STRINGIFY(
                                 \n#version 150\n
                                 uniform sampler2D inputImageTexture;
                                 
@@ -1180,3 +1420,421 @@ void createKuwahara3Shader(ofShader &shader) {
     
     createSimpleShader(shader,fragment);
 }
+
+static bool isTexelOffset(int i,int j) {
+    // the spec only guarantees [-8,7] for GL_MIN/MAX_PROGRAM_TEXEL_OFFSET
+    return i>=-8 && i<=7 && j>=-8 && j<=7;
+}
+
+static void addKuwaharaSample(stringstream &frag,int i,int j,string square) {
+    bool q[4];
+    q[0] = i<=0 && j<=0;
+    q[1] = i>=0 && j<=0;
+    q[2] = i>=0 && j>=0;
+    q[3] = i<=0 && j>=0;
+    
+    int count = 0;
+    for (int k=0;k<4;k++) {
+        count+=q[k];
+    }
+    
+    if (count>1) {
+        frag << "cSq = " << square << ";";
+    }
+    
+    for (int k=0;k<4;k++) {
+        if (q[k]) {
+            frag << "m" << k << " += c;";
+            frag << "s" << k << " += " << (count>1 ? "cSq" : square) << ";";
+        }
+    }
+}
+
+string getKuwaharaFragment(int radius,bool luma) {
+    
+    stringstream frag;
+    frag << STRINGIFY(
+                      \n#version 150\n
+                      );
+    if (luma) {
+        frag << STRINGIFY(
+                          \n#extension GL_ARB_texture_gather : enable\n
+                          );
+    }
+    
+    frag << STRINGIFY(
+                      uniform sampler2D inputImageTexture;
+                      
+                      in vec2 texCoordVarying;
+                      out vec4 fragColor;
+                      
+                      void main (void)
+                      );
+    
+    string type = luma ? "float" : "vec3";
+    
+    frag << "{";
+    frag << "vec2 src_size = 1.0/textureSize(inputImageTexture,0);";
+    frag << "vec2 uv = texCoordVarying;";
+    frag << "float n = float(" << (radius+1)*(radius+1) << ");";
+    for (int k=0;k<4;k++) {
+        frag << type << " m" << k << " = " << type << "(0.0);";
+        frag << type << " s" << k << " = " << type << "(0.0);";
+    }
+    frag << type << " c;";
+    frag << type << " cSq;";
+    
+    // samples are taken relative to the center texel, on smooth input the variances of the
+    // quadrants are tiny next to the squared means and s/n-m*m would cancel to float noise,
+    // picking quadrants at random between near equal ones
+
+    if (luma) {
+        // gather the 2x2 footprint to the upper right of each block, the half texel
+        // shift keeps the footprint origin away from texel boundaries
+        frag << "vec2 corner = uv + 0.5 * src_size;";
+        frag << "vec4 g;";
+        frag << "float a = 1.0;";
+        frag << "float center = texture(inputImageTexture, uv).r;";
+        
+        // component order of textureGather: x=(0,1) y=(1,1) z=(1,0) w=(0,0)
+        const int di[4] = {0,1,1,0};
+        const int dj[4] = {1,1,0,0};
+        const char *comp = "xyzw";
+        
+        for (int bj=-radius; bj<=radius; bj+=2) {
+            for (int bi=-radius; bi<=radius; bi+=2) {
+                if (isTexelOffset(bi, bj)) {
+                    frag << "g = textureGatherOffset(inputImageTexture,corner,ivec2(" << bi << "," << bj << "));";
+                } else {
+                    frag << "g = textureGather(inputImageTexture,corner + vec2(" << bi << "," << bj << ") * src_size);";
+                }
+                for (int k=0;k<4;k++) {
+                    int i = bi+di[k];
+                    int j = bj+dj[k];
+                    if (i>radius || j>radius) {
+                        continue;
+                    }
+                    frag << "c = g." << comp[k] << " - center;";
+                    addKuwaharaSample(frag, i, j, "c * c");
+                }
+            }
+        }
+    } else {
+        frag << "vec4 texel = texture(inputImageTexture, uv);";
+        frag << "float a = texel.a;";
+        frag << "vec3 center = texel.rgb;";
+        for (int i=-radius; i<=radius; i++) {
+            for (int j=-radius; j<=radius; j++) {
+                if (isTexelOffset(i, j)) {
+                    frag << "c = textureOffset(inputImageTexture,uv,ivec2(" << i << "," << j << ")).rgb - center;";
+                } else {
+                    frag << "c = texture(inputImageTexture,uv + vec2(" << i << "," << j << ") * src_size).rgb - center;";
+                }
+                addKuwaharaSample(frag, i, j, "c * c");
+            }
+        }
+    }
+    
+    frag << "float min_sigma2 = 1e+2;";
+    frag << "float sigma2;";
+    for (int k=0;k<4;k++) {
+        frag << "m" << k << " /= n;";
+        frag << "s" << k << " = abs(s" << k << " / n - m" << k << " * m" << k << ");";
+        if (luma) {
+            frag << "sigma2 = s" << k << ";";
+        } else {
+            frag << "sigma2 = s" << k << ".r + s" << k << ".g + s" << k << ".b;";
+        }
+        frag << "if (sigma2 < min_sigma2) {";
+        frag << "min_sigma2 = sigma2;";
+        frag << "fragColor = vec4(" << (luma ? "vec3(m" : "m") << k << " + center" << (luma ? ")" : "") << ", a);";
+        frag << "}";
+    }
+    frag << "}";
+    
+    return frag.str();
+}
+
+void createKuwaharaShader(ofShader &shader,int radius,bool luma) {
+    createSimpleShader(shader,getShaderSource(SHADER_SOURCE_KUWAHARA, radius, 0, luma));
+}
+
+ofShader &getKuwaharaShader(int radius,bool luma) {
+    static map<int,ofShader> shaders;
+    
+    int clamped = ofClamp(radius, 1, 8);
+    if (clamped!=radius) {
+        ofLogWarning("Shaders") << "getKuwaharaShader: radius " << radius << " clamped to " << clamped;
+    }
+    
+    int key = clamped*2+luma;
+    ofShader &shader = shaders[key];
+    if (!shader.isLoaded()) {
+        createKuwaharaShader(shader,clamped,luma);
+    }
+    return shader;
+}
+
+// texture array variants, one instance per layer routed with gl_Layer. per layer
+// parameters are uniform arrays indexed by the layer, draw with TextureArray
+
+const string &getArrayVertex() {
+    static const string source = STRINGIFY(
+                     \n#version 150\n
+                     out vec2 texCoord;
+                     flat out int instance;
+                     
+                     void main() {
+                         vec2 p = vec2((gl_VertexID<<1)&2, gl_VertexID&2);
+                         texCoord = p;
+                         instance = gl_InstanceID;
+                         gl_Position = vec4(p*2.0-1.0,0.0,1.0);
+                     }
+                     );
+    return source;
+}
+
+const string &getArrayGeometry() {
+    static const string source = STRINGIFY(
+                     \n#version 150\n
+                     layout(triangles) in;
+                     layout(triangle_strip, max_vertices = 3) out;
+                     
+                     in vec2 texCoord[];
+                     flat in int instance[];
+                     out vec2 texCoordVarying;
+                     flat out int layer;
+                     
+                     void main() {
+                         for (int i = 0; i < 3; i++) {
+                             gl_Layer = instance[0];
+                             layer = instance[0];
+                             texCoordVarying = texCoord[i];
+                             gl_Position = gl_in[i].gl_Position;
+                             EmitVertex();
+                         }
+                         EndPrimitive();
+                     }
+                     );
+    return source;
+}
+
+void createArrayShader(ofShader &shader,const string &fragment) {
+    shader.setupShaderFromSource(GL_VERTEX_SHADER, getArrayVertex());
+    shader.setupShaderFromSource(GL_GEOMETRY_SHADER, getArrayGeometry());
+    shader.setupShaderFromSource(GL_FRAGMENT_SHADER, fragment);
+    shader.bindDefaults();
+    shader.linkProgram();
+}
+
+static string getArrayHeader(int layers) {
+    stringstream header;
+    header << STRINGIFY(
+                        \n#version 150\n
+                        in vec2 texCoordVarying;
+                        flat in int layer;
+                        out vec4 fragColor;
+                        );
+    header << "\n#define LAYERS " << layers << "\n";
+    return header.str();
+}
+
+void createDepthArrayShader(ofShader &shader,int layers) {
+    stringstream fragment;
+    fragment << getArrayHeader(layers);
+    fragment << STRINGIFY(
+                          uniform sampler2DArray tex0;
+                          uniform float minEdge[LAYERS];
+                          uniform float maxEdge[LAYERS];
+                          
+                          void main(void) {
+                              float sample = texture(tex0,vec3(texCoordVarying,layer)).r;
+                              float dist = (sample-minEdge[layer])/(maxEdge[layer]-minEdge[layer]);
+                              float color = (1-dist)*(step(minEdge[layer],sample)-step(maxEdge[layer],sample));
+                              fragColor = vec4(vec3(color),1.0);
+                          }
+                          );
+    
+    createArrayShader(shader,fragment.str());
+}
+
+void createDepthMaskArrayShader(ofShader &shader,int layers) {
+    stringstream fragment;
+    fragment << getArrayHeader(layers);
+    fragment << STRINGIFY(
+                          uniform sampler2DArray tex0;
+                          uniform sampler2DArray bgTex;
+                          uniform float minEdge[LAYERS];
+                          uniform float maxEdge[LAYERS];
+                          uniform float tolerance[LAYERS];
+                          
+                          void main(void) {
+                              vec3 uv = vec3(texCoordVarying,layer);
+                              float c = texture(tex0,uv).r;
+                              float bg = texture(bgTex,uv).r;
+                              float sample = mix(0,c,abs(c-bg)>tolerance[layer]);
+                              float color = step(minEdge[layer],sample)-step(maxEdge[layer],sample);
+                              fragColor = vec4(vec3(color),1.0);
+                          }
+                          );
+    
+    createArrayShader(shader,fragment.str());
+}
+
+void createDepthBackgroundSubtractionArrayShader(ofShader &shader,int layers) {
+    stringstream fragment;
+    fragment << getArrayHeader(layers);
+    fragment << STRINGIFY(
+                          uniform sampler2DArray tex0;
+                          uniform sampler2DArray bgTex;
+                          uniform float tolerance[LAYERS];
+                          
+                          void main(void) {
+                              vec3 uv = vec3(texCoordVarying,layer);
+                              float c = texture(tex0,uv).r;
+                              float bg = texture(bgTex,uv).r;
+                              bool mask = abs(c-bg)>tolerance[layer];
+                              fragColor = vec4(vec3(mix(0,c,mask)),1.0);
+                          }
+                          );
+    
+    createArrayShader(shader,fragment.str());
+}
+
+void createDepthBlurArrayShader(ofShader &shader,int layers,int radius,double variance) {
+    vector<double> coefs;
+    createCoefficients(radius,variance,coefs);
+    
+    stringstream fragment;
+    fragment << getArrayHeader(layers);
+    fragment << STRINGIFY(
+                          uniform sampler2DArray tex0;
+                          uniform vec2 dir;
+                          
+                          void main(void)
+                          );
+    
+    fragment << "{ float color = 0.0;";
+    
+    for (int i=0; i<radius*2+1; i++) {
+        fragment << "color += texture(tex0,vec3(texCoordVarying + " << i-radius << " * dir,layer)).r*" << coefs[i] << ";";
+    }
+    
+    fragment << "fragColor=vec4(vec3(color),1.0);}";
+    
+    createArrayShader(shader,fragment.str());
+}
+
+static bool isBackgroundEffect(PointwiseEffect effect) {
+    return effect==POINTWISE_DEPTH_MASK || effect==POINTWISE_DEPTH_BACKGROUND_SUBTRACTION;
+}
+
+static bool isEdgesEffect(PointwiseEffect effect) {
+    return effect==POINTWISE_DEPTH || effect==POINTWISE_DEPTH_MASK;
+}
+
+// same expressions as the single effect shaders
+static string getPointwiseValue(PointwiseEffect effect) {
+    switch (effect) {
+        case POINTWISE_DEPTH:
+            return "(1-(c-minEdge)/(maxEdge-minEdge))*(step(minEdge,c)-step(maxEdge,c))";
+        case POINTWISE_DEPTH_MASK:
+            return "(step(minEdge,subtracted)-step(maxEdge,subtracted))";
+        case POINTWISE_DEPTH_BACKGROUND_SUBTRACTION:
+            return "subtracted";
+        case POINTWISE_THRESHOLD:
+            return "smoothstep(edge0,edge1,c)*c";
+        default:
+            return "dot(texel.rgb,vec3(0.299, 0.587, 0.114))";
+    }
+}
+
+static string getFanOutName(int i) {
+    return "fragColor" + ofToString(i);
+}
+
+static string renameFragColor(string line,string name) {
+    size_t pos = line.find("fragColor");
+    return line.replace(pos, string("fragColor").size(), name);
+}
+
+string getFanOutFragment(const vector<FanOutput> &outputs,bool edgesTexture) {
+    bool background = false;
+    bool edges = false;
+    bool threshold = false;
+    
+    for (vector<FanOutput>::const_iterator iter=outputs.begin();iter!=outputs.end();iter++) {
+        background = background || isBackgroundEffect(iter->effect);
+        edges = edges || isEdgesEffect(iter->effect);
+        threshold = threshold || iter->effect==POINTWISE_THRESHOLD;
+    }
+    
+    stringstream fragment;
+    fragment << STRINGIFY(
+                          \n#version 150\n
+                          \n#extension GL_ARB_explicit_attrib_location : enable\n
+                          uniform sampler2D tex0;
+                          );
+    
+    if (background) {
+        fragment << "uniform sampler2D bgTex;\nuniform float tolerance;\n";
+    }
+    if (edges) {
+        fragment << getDepthEdges(edgesTexture);
+    }
+    if (threshold) {
+        fragment << "uniform float edge0;\nuniform float edge1;\n";
+    }
+    
+    fragment << "in vec2 texCoordVarying;\n";
+    
+    for (int i=0;i<outputs.size();i++) {
+        fragment << "layout (location = " << i << ") " << renameFragColor(getFragmentOutput(outputs[i].format), getFanOutName(i)) << "\n";
+    }
+    
+    fragment << STRINGIFY(
+                          void main(void) {
+                              vec4 texel = texture(tex0,texCoordVarying);
+                              float c = texel.r;
+                          );
+    
+    if (background) {
+        fragment << STRINGIFY(
+                              float bg = texture(bgTex,texCoordVarying).r;
+                              float subtracted = mix(0,c,abs(c-bg)>tolerance);
+                              );
+    }
+    
+    for (int i=0;i<outputs.size();i++) {
+        fragment << renameFragColor(getFragmentAssignment(outputs[i].format, getPointwiseValue(outputs[i].effect)), getFanOutName(i)) << "\n";
+    }
+    
+    fragment << "}";
+    
+    return fragment.str();
+}
+
+void createFanOutShader(ofShader &shader,const vector<FanOutput> &outputs,bool edgesTexture) {
+    createSimpleShader(shader,getFanOutFragment(outputs,edgesTexture));
+}
+
+void allocateFanOut(ofFbo &fbo,int width,int height,const vector<FanOutput> &outputs) {
+    ofFbo::Settings settings;
+    settings.width = width;
+    settings.height = height;
+    for (vector<FanOutput>::const_iterator iter=outputs.begin();iter!=outputs.end();iter++) {
+        settings.colorFormats.push_back(getFormatInternal(iter->format));
+    }
+    fbo.allocate(settings);
+    
+    for (int i=0;i<outputs.size();i++) {
+        if (getFormatChannels(outputs[i].format)<4) {
+            // same swizzle as allocateTarget
+            GLint swizzle[4] = {GL_RED,GL_RED,GL_RED,getFormatChannels(outputs[i].format)==2 ? GL_GREEN : GL_ONE};
+            ofTextureData &data = fbo.getTextureReference(i).getTextureData();
+            glBindTexture(data.textureTarget, data.textureID);
+            glTexParameteriv(data.textureTarget, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+            glBindTexture(data.textureTarget, 0);
+        }
+    }
+}
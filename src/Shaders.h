@@ -10,30 +10,114 @@
 
 #include "ofMain.h"
 
-string getSimpleVertex();
-void createSimpleShader(ofShader &shader,string fragment);
-void createDepthShader(ofShader &shader);
-void createDepthMaskShader(ofShader &shader);
-void createColor2GrayShader(ofShader &shader);
+// output of single channel effects, RGBA8 keeps the original vec4 output
+enum ShaderFormat {
+    SHADER_FORMAT_RGBA8,
+    SHADER_FORMAT_R8,
+    SHADER_FORMAT_R16F,
+    SHADER_FORMAT_RG16F // gray + alpha
+};
+
+GLint getFormatInternal(ShaderFormat format);
+int getFormatChannels(ShaderFormat format);
+int getFormatBytes(ShaderFormat format);
+string getFormatName(ShaderFormat format);
+string getFragmentOutput(ShaderFormat format);
+string getFragmentAssignment(ShaderFormat format,const string &value);
+void allocateTarget(ofFbo &fbo,int width,int height,ShaderFormat format); // swizzles gray targets to rgb
+string getChainMemoryReport(const vector<ShaderFormat> &formats,int width,int height);
+
+const string &getSimpleVertex();
+void createShader(ofShader &shader,const string &vertex,const string &fragment);
+void createSimpleShader(ofShader &shader,const string &fragment);
+
+// full screen triangle without attributes for passes addressing texels by gl_FragCoord,
+// draw with 3 vertices and any vertex array bound
+const string &getQuadVertex();
+void createQuadShader(ofShader &shader,const string &fragment);
+GLuint createTargetTexture(int width,int height,GLint internalFormat,GLenum format,int levels=1); // nearest, clamped
+void createDepthShader(ofShader &shader,ShaderFormat format=SHADER_FORMAT_RGBA8);
+string getDepthMaskFragment(ShaderFormat format=SHADER_FORMAT_RGBA8);
+void createDepthMaskShader(ofShader &shader,ShaderFormat format=SHADER_FORMAT_RGBA8);
+// minEdge/maxEdge read from edgesTex, see DepthStatistics::getEdgesTexture
+void createAutoDepthShader(ofShader &shader,ShaderFormat format=SHADER_FORMAT_RGBA8);
+void createAutoDepthMaskShader(ofShader &shader,ShaderFormat format=SHADER_FORMAT_RGBA8);
+string getColor2GrayFragment(ShaderFormat format=SHADER_FORMAT_RGBA8);
+void createColor2GrayShader(ofShader &shader,ShaderFormat format=SHADER_FORMAT_RGBA8);
+// normalized gaussian taps for offsets -radius..radius mapped to [-1,1]
+void createCoefficients(int radius,double variance,vector<double> &coefs);
+// sources of the generated blurs, e.g. for analyzeShader before compiling
+string getFastBlurVertex(int radius);
+string getFastBlurFragment(int radius,double variance);
+string getBlurFragment(int radius,double variance);
+string getDepthBlurFragment(int radius,double variance,ShaderFormat format=SHADER_FORMAT_RGBA8);
+string getVarDepthBlurFragment(int radius,double variance);
 void createFastBlurShader(ofShader &shader,int radius,double variance);
 void createBlurShader(ofShader &shader,int radius,double variance);
-void createDepthBlurShader(ofShader &shader,int radius,double variance);
+void createDepthBlurShader(ofShader &shader,int radius,double variance,ShaderFormat format=SHADER_FORMAT_RGBA8);
 void createVarDepthBlurShader(ofShader &shader,int radius,double variance);
-void createThresholdShader(ofShader &shader);
+void createThresholdShader(ofShader &shader,ShaderFormat format=SHADER_FORMAT_RGBA8);
 void createScreenShader(ofShader &shader);
 void createBlendShader(ofShader &shader);
 void createScreenMultipleShader(ofShader &shader);
 void createHSLShader(ofShader &shader);
 void createEchoShader(ofShader &shader);
 void createStrobeShader(ofShader &shader);
-void createDepthBackgroundSubtractionShader(ofShader &shader);
+void createDepthBackgroundSubtractionShader(ofShader &shader,ShaderFormat format=SHADER_FORMAT_RGBA8);
+const string &getMaskingFragment();
 void createMaskingShader(ofShader &shader);
 void createInverseMaskingShader(ofShader &shader);
 void createCloudShader(ofShader &shader);
 
 void createBorderShader(ofShader &shader);
 void createDilationShader(ofShader &shader);
+// distTex from DistanceField, thickness and radius in pixels at any size
+void createDistanceOutlineShader(ofShader &shader);
+void createDistanceDilationShader(ofShader &shader);
+void createDistanceErosionShader(ofShader &shader);
+void createDistanceGlowShader(ofShader &shader);
+const string &getHalftoneFragment();
 void createHalftoneShader(ofShader &shader);
 void createKuwaharaShader(ofShader &shader);
 void createKuwahara3Shader(ofShader &shader);
 
+// unrolled kuwahara for radius 1..8 using constant texel offsets, luma reads a single
+// channel input with textureGather (4 texels per fetch) and writes gray
+string getKuwaharaFragment(int radius,bool luma=false);
+void createKuwaharaShader(ofShader &shader,int radius,bool luma=false);
+ofShader &getKuwaharaShader(int radius,bool luma=false); // cached per radius
+
+
+// sampler2DArray versions processing every layer (sensor) in one instanced draw,
+// minEdge, maxEdge and tolerance are float[layers] uniforms
+const string &getArrayVertex();
+const string &getArrayGeometry();
+void createArrayShader(ofShader &shader,const string &fragment);
+void createDepthArrayShader(ofShader &shader,int layers);
+void createDepthMaskArrayShader(ofShader &shader,int layers);
+void createDepthBackgroundSubtractionArrayShader(ofShader &shader,int layers);
+void createDepthBlurArrayShader(ofShader &shader,int layers,int radius,double variance);
+
+
+// pointwise effects of a depth (or color) input that can share one pass, see getFanOutFragment
+enum PointwiseEffect {
+    POINTWISE_DEPTH,                        // tex0, minEdge, maxEdge
+    POINTWISE_DEPTH_MASK,                   // tex0, bgTex, tolerance, minEdge, maxEdge
+    POINTWISE_DEPTH_BACKGROUND_SUBTRACTION, // tex0, bgTex, tolerance
+    POINTWISE_THRESHOLD,                    // tex0, edge0, edge1
+    POINTWISE_COLOR2GRAY                    // tex0
+};
+
+struct FanOutput {
+    FanOutput(PointwiseEffect effect,ShaderFormat format=SHADER_FORMAT_RGBA8) : effect(effect),format(format) {}
+    
+    PointwiseEffect effect;
+    ShaderFormat format;
+};
+
+// one pass writing output i to layout (location = i) instead of a pass per effect, inputs
+// are fetched once and uniforms are shared by name (e.g. tolerance of mask and subtraction)
+string getFanOutFragment(const vector<FanOutput> &outputs,bool edgesTexture=false);
+void createFanOutShader(ofShader &shader,const vector<FanOutput> &outputs,bool edgesTexture=false);
+// color attachment i for output i, call fbo.activateAllDrawBuffers() after fbo.begin()
+void allocateFanOut(ofFbo &fbo,int width,int height,const vector<FanOutput> &outputs);
@@ -0,0 +1,150 @@
+//
+//  StencilMask.cpp
+//  depthBlur
+//
+//
+
+#include "StencilMask.h"
+#include "ShaderChain.h"
+#include "GpuTimer.h"
+
+StencilMask::StencilMask() {
+    renderbuffer = 0;
+}
+
+StencilMask::~StencilMask() {
+    if (renderbuffer) {
+        glDeleteRenderbuffers(1, &renderbuffer);
+    }
+}
+
+void StencilMask::setup(int width,int height) {
+    if (!renderbuffer) {
+        glGenRenderbuffers(1, &renderbuffer);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+}
+
+void StencilMask::attach(ofFbo &fbo) {
+    GLint previous;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo.getFbo());
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, previous);
+}
+
+bool StencilMask::isAllocated() {
+    return renderbuffer!=0;
+}
+
+void StencilMask::clear() {
+    glStencilMask(0xFF);
+    glClearStencil(0);
+    glClear(GL_STENCIL_BUFFER_BIT);
+}
+
+void StencilMask::beginWrite() {
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(0xFF);
+    glStencilFunc(GL_ALWAYS, 1, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+}
+
+void StencilMask::beginTest() {
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(0);
+    glStencilFunc(GL_EQUAL, 1, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+}
+
+void StencilMask::end() {
+    glStencilMask(0xFF);
+    glDisable(GL_STENCIL_TEST);
+}
+
+string getStencilMaskFragment(const string &fragment,const string &coverage) {
+    size_t start = fragment.find("void main");
+    size_t end = fragment.find(')', start);
+    if (start==string::npos || end==string::npos) {
+        ofLogError("StencilMask") << "no main in the fragment";
+        return fragment;
+    }
+    
+    stringstream masked;
+    masked << fragment.substr(0, start) << "void maskMain()" << fragment.substr(end+1);
+    masked << "void main(void) {";
+    masked << "maskMain();";
+    masked << "if (" << coverage << "==0.0) discard;";
+    masked << "}";
+    return masked.str();
+}
+
+void createStencilMaskShader(ofShader &shader,const string &fragment,const string &coverage) {
+    createSimpleShader(shader,getStencilMaskFragment(fragment, coverage));
+}
+
+static float getChainMillis(ShaderChain &chain) {
+    chain.update(); // first use of the targets and the first query are not representative
+    GpuTimer timer;
+    timer.begin();
+    chain.update();
+    timer.end();
+    return timer.getMillis();
+}
+
+string getStencilBenchmark(ofShader &effect,string textureName,ofTexture &input,int passes) {
+    int width = input.getWidth();
+    int height = input.getHeight();
+    
+    ofShader maskShader;
+    createStencilMaskShader(maskShader, getColor2GrayFragment(SHADER_FORMAT_R8));
+    
+    const float coverages[] = {0.05,0.25,0.5,0.75,1.0};
+    
+    stringstream report;
+    report << "coverage\tfull\tstencil" << endl;
+    for (int i=0;i<sizeof(coverages)/sizeof(coverages[0]);i++) {
+        // centered rectangle with the aspect of the frame
+        float side = sqrt(coverages[i]);
+        ofRectangle rect(0.5*width*(1-side), 0.5*height*(1-side), width*side, height*side);
+        
+        ofPixels pixels;
+        pixels.allocate(width, height, 3);
+        for (int y=0;y<height;y++) {
+            for (int x=0;x<width;x++) {
+                unsigned char value = rect.inside(x+0.5, y+0.5) ? 255 : 0;
+                for (int k=0;k<3;k++) {
+                    pixels[(y*width+x)*3+k] = value;
+                }
+            }
+        }
+        ofTexture mask;
+        mask.allocate(width, height, GL_RGB8);
+        mask.loadData(pixels);
+        
+        float millis[2];
+        for (int test=0;test<2;test++) {
+            ShaderChain chain;
+            chain.setup(width, height);
+            int source = chain.addInput(input);
+            int maskSource = chain.addInput(mask);
+            int maskPass = chain.addPass(maskShader, SHADER_FORMAT_R8);
+            chain.setTexture(maskPass, "tex0", maskSource);
+            chain.setStencilMask(maskPass);
+            for (int j=0;j<passes;j++) {
+                int pass = chain.addPass(effect);
+                chain.setTexture(pass, textureName, source);
+                chain.setStencilTest(pass, test);
+            }
+            chain.allocate();
+            millis[test] = getChainMillis(chain);
+        }
+        
+        report << coverages[i]*100 << "%\t" << millis[0] << " ms\t" << millis[1] << " ms";
+        report << " (" << (millis[1]>0 ? millis[0]/millis[1] : 0) << "x)" << endl;
+    }
+    
+    return report.str();
+}
@@ -0,0 +1,43 @@
+//
+//  StencilMask.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "Shaders.h"
+
+// depth-stencil renderbuffer shared by the targets of a chain. a mask pass writes 1 wherever
+// it does not discard, later passes test for 1 so the gpu rejects unmasked fragments before
+// shading them, see ShaderChain::setStencilMask
+class StencilMask {
+public:
+    
+    StencilMask();
+    ~StencilMask();
+    
+    void setup(int width,int height);
+    void attach(ofFbo &fbo); // same size as setup
+    bool isAllocated();
+    
+    void clear();      // on the bound fbo
+    void beginWrite(); // 1 for every fragment drawn
+    void beginTest();  // only fragments over 1
+    void end();
+    
+private:
+    
+    GLuint renderbuffer;
+};
+
+// the mask fragment with main renamed and a main discarding where coverage is 0, coverage is
+// an expression of fragColor: float(fragColor) for depth masks, fragColor.a for createMaskingShader.
+// discarded pixels keep the cleared (0,0,0,0) instead of the mask output
+string getStencilMaskFragment(const string &fragment,const string &coverage="float(fragColor)");
+void createStencilMaskShader(ofShader &shader,const string &fragment,const string &coverage="float(fragColor)");
+
+// effect passes over the input with and without the stencil test behind a rectangular mask
+// covering 5% to 100% of the frame, the effect keeps the uniforms it was last given
+string getStencilBenchmark(ofShader &effect,string textureName,ofTexture &input,int passes=4);
@@ -0,0 +1,219 @@
+//
+//  TemporalAmortizer.cpp
+//  depthBlur
+//
+//
+
+#include "TemporalAmortizer.h"
+
+#define STRINGIFY(A) #A
+
+// the pixel slot in the pattern, shared by the effect and the reference pass
+static string getScheduling() {
+    return STRINGIFY(
+                     uniform sampler2D referenceTex;
+                     uniform int pattern;
+                     uniform int phase;
+                     uniform int full;
+                     uniform float threshold;
+                     
+                     bool isScheduled(ivec2 p,vec4 c) {
+                         int slot = pattern == 2 ? (p.x+p.y) % 2 : (p.x % 2)+2*(p.y % 2);
+                         if (full == 1 || pattern <= 1 || slot == phase) {
+                             return true;
+                         }
+                         vec4 d = abs(c-texelFetch(referenceTex,p,0));
+                         return max(max(d.r,d.g),max(d.b,d.a)) > threshold;
+                     }
+                     );
+}
+
+string getAmortizedFragment(const string &fragment,const string &textureName) {
+    size_t start = fragment.find("void main");
+    size_t end = fragment.find(')', start);
+    if (start==string::npos || end==string::npos) {
+        ofLogError("TemporalAmortizer") << "no main in the fragment";
+        return fragment;
+    }
+    
+    stringstream amortized;
+    amortized << fragment.substr(0, start) << "void effectMain()" << fragment.substr(end+1);
+    amortized << getScheduling();
+    amortized << "void main(void) {";
+    amortized << "ivec2 p = ivec2(gl_FragCoord.xy);";
+    amortized << "if (!isScheduled(p,texelFetch(" << textureName << ",p,0))) discard;";
+    amortized << "effectMain();";
+    amortized << "}";
+    return amortized.str();
+}
+
+TemporalAmortizer::TemporalAmortizer() {
+    pattern = 2;
+    threshold = 0.02;
+    phase = 0;
+    full = true;
+    current = 0;
+    query = 0;
+    queryPending = false;
+    renderedFraction = 1;
+    referenceFormat = 0;
+}
+
+TemporalAmortizer::~TemporalAmortizer() {
+    if (query) {
+        glDeleteQueries(1, &query);
+    }
+}
+
+void TemporalAmortizer::setup(int width,int height,const string &fragment,string textureName,ShaderFormat format) {
+    this->width = width;
+    this->height = height;
+    this->textureName = textureName;
+    
+    allocateTarget(output, width, height, format);
+    referenceFormat = 0; // allocated by the first update, in the precision of the input
+    
+    quad.clear();
+    quad.setMode(OF_PRIMITIVE_TRIANGLE_FAN);
+    quad.addVertex(ofVec3f(0,0));
+    quad.addTexCoord(ofVec2f(0,0));
+    quad.addVertex(ofVec3f(width,0));
+    quad.addTexCoord(ofVec2f(1,0));
+    quad.addVertex(ofVec3f(width,height));
+    quad.addTexCoord(ofVec2f(1,1));
+    quad.addVertex(ofVec3f(0,height));
+    quad.addTexCoord(ofVec2f(0,1));
+    
+    createSimpleShader(shader, getAmortizedFragment(fragment, textureName));
+    
+    stringstream referenceFragment;
+    referenceFragment << STRINGIFY(
+                                   \n#version 150\n
+                                   uniform sampler2D tex0;
+                                   out vec4 fragColor;
+                                   );
+    referenceFragment << getScheduling();
+    referenceFragment << STRINGIFY(
+                                   void main(void) {
+                                       ivec2 p = ivec2(gl_FragCoord.xy);
+                                       vec4 c = texelFetch(tex0,p,0);
+                                       fragColor = isScheduled(p,c) ? c : texelFetch(referenceTex,p,0);
+                                   }
+                                   );
+    createSimpleShader(referenceShader, referenceFragment.str());
+    
+    if (!query) {
+        glGenQueries(1, &query);
+    }
+    queryPending = false;
+    reset();
+}
+
+void TemporalAmortizer::setPattern(int pattern) {
+    pattern = pattern==4 ? 4 : (pattern==2 ? 2 : 1);
+    if (pattern!=this->pattern) {
+        // the phase of the old pattern may not exist in the new one
+        this->pattern = pattern;
+        phase = 0;
+        reset();
+    }
+}
+
+void TemporalAmortizer::setThreshold(float threshold) {
+    this->threshold = threshold;
+}
+
+void TemporalAmortizer::setUniform(string name,float value) {
+    floats[name] = value;
+}
+
+void TemporalAmortizer::setUniform(string name,float x,float y) {
+    vecs[name] = ofVec2f(x,y);
+}
+
+void TemporalAmortizer::setUniform(string name,int value) {
+    ints[name] = value;
+}
+
+void TemporalAmortizer::reset() {
+    full = true;
+}
+
+void TemporalAmortizer::update(ofTexture &input) {
+    if (queryPending) {
+        GLint available;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint samples;
+            glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samples);
+            renderedFraction = (float)samples/(width*height);
+            queryPending = false;
+        }
+    }
+    
+    // an 8 bit reference would hide changes of a 16 bit or float input below 1/255
+    GLint format = input.getTextureData().glTypeInternal;
+    if (format!=referenceFormat) {
+        for (int i=0;i<2;i++) {
+            reference[i].allocate(width, height, format);
+            reference[i].getTextureReference().setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+        }
+        referenceFormat = format;
+        reset();
+    }
+    
+    ofTexture &previous = reference[current].getTextureReference();
+    
+    // both passes see the same reference, the effect before it is updated
+    output.begin();
+    shader.begin();
+    shader.setUniformTexture(textureName, input, 0);
+    shader.setUniformTexture("referenceTex", previous, 1);
+    shader.setUniform1i("pattern", pattern);
+    shader.setUniform1i("phase", phase);
+    shader.setUniform1i("full", full);
+    shader.setUniform1f("threshold", threshold);
+    for (map<string,float>::iterator iter=floats.begin();iter!=floats.end();iter++) {
+        shader.setUniform1f(iter->first, iter->second);
+    }
+    for (map<string,ofVec2f>::iterator iter=vecs.begin();iter!=vecs.end();iter++) {
+        shader.setUniform2f(iter->first, iter->second.x, iter->second.y);
+    }
+    for (map<string,int>::iterator iter=ints.begin();iter!=ints.end();iter++) {
+        shader.setUniform1i(iter->first, iter->second);
+    }
+    if (!queryPending) {
+        glBeginQuery(GL_SAMPLES_PASSED, query);
+    }
+    quad.draw();
+    if (!queryPending) {
+        glEndQuery(GL_SAMPLES_PASSED);
+        queryPending = true;
+    }
+    shader.end();
+    output.end();
+    
+    reference[1-current].begin();
+    referenceShader.begin();
+    referenceShader.setUniformTexture("tex0", input, 0);
+    referenceShader.setUniformTexture("referenceTex", previous, 1);
+    referenceShader.setUniform1i("pattern", pattern);
+    referenceShader.setUniform1i("phase", phase);
+    referenceShader.setUniform1i("full", full);
+    referenceShader.setUniform1f("threshold", threshold);
+    quad.draw();
+    referenceShader.end();
+    reference[1-current].end();
+    
+    current = 1-current;
+    phase = (phase+1)%pattern;
+    full = false;
+}
+
+ofTexture &TemporalAmortizer::getTexture() {
+    return output.getTextureReference();
+}
+
+float TemporalAmortizer::getRenderedFraction() {
+    return renderedFraction;
+}
@@ -0,0 +1,61 @@
+//
+//  TemporalAmortizer.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "Shaders.h"
+
+// renders an effect over 1/2 (checkerboard) or 1/4 (2x2 interleave) of the pixels per
+// frame into a persistent output, the others keep their last result. a pixel whose input
+// moved more than the threshold since it was last rendered is rendered anyway.
+// the fragment is any single input effect, e.g. getKuwaharaFragment
+class TemporalAmortizer {
+public:
+    
+    TemporalAmortizer();
+    ~TemporalAmortizer();
+    
+    void setup(int width,int height,const string &fragment,string textureName="tex0",ShaderFormat format=SHADER_FORMAT_RGBA8);
+    void setPattern(int pattern); // 1 every pixel, 2 or 4 frames per pixel, a change renders every pixel once
+    void setThreshold(float threshold); // largest channel difference still reused
+    void setUniform(string name,float value);
+    void setUniform(string name,float x,float y);
+    void setUniform(string name,int value);
+    void reset(); // every pixel on the next update
+    
+    void update(ofTexture &input);
+    
+    ofTexture &getTexture();
+    float getRenderedFraction(); // pixels the last collected frame rendered, from an occlusion query
+    
+private:
+    
+    int width;
+    int height;
+    string textureName;
+    int pattern;
+    float threshold;
+    int phase;
+    bool full;
+    map<string,float> floats;
+    map<string,ofVec2f> vecs;
+    map<string,int> ints;
+    
+    ofShader shader;
+    ofShader referenceShader;
+    ofFbo output;
+    ofFbo reference[2]; // input as of the last render of each pixel, in the input's format
+    GLint referenceFormat;
+    int current;
+    ofMesh quad;
+    GLuint query;
+    bool queryPending;
+    float renderedFraction;
+};
+
+// the fragment with main renamed and a main scheduling the pixel in front of it
+string getAmortizedFragment(const string &fragment,const string &textureName);
@@ -0,0 +1,124 @@
+//
+//  TextureArray.cpp
+//  depthBlur
+//
+//
+
+#include "TextureArray.h"
+
+static GLenum getPixelFormat(int channels) {
+    switch (channels) {
+        case 1:
+            return GL_RED;
+        case 2:
+            return GL_RG;
+        case 3:
+            return GL_RGB;
+        default:
+            return GL_RGBA;
+    }
+}
+
+TextureArray::TextureArray() {
+    texture = 0;
+    width = height = layers = 0;
+}
+
+TextureArray::~TextureArray() {
+    release();
+}
+
+void TextureArray::release() {
+    if (!texture) {
+        return;
+    }
+    glDeleteTextures(1, &texture);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteVertexArrays(1, &vao);
+    texture = 0;
+}
+
+void TextureArray::allocate(int width,int height,int layers,ShaderFormat format) {
+    allocate(width, height, layers, getFormatInternal(format));
+}
+
+void TextureArray::allocate(int width,int height,int layers,GLint internalFormat) {
+    release();
+    
+    this->width = width;
+    this->height = height;
+    this->layers = layers;
+    
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER)!=GL_FRAMEBUFFER_COMPLETE) {
+        ofLogError("TextureArray") << "layered framebuffer incomplete";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    
+    glGenVertexArrays(1, &vao);
+}
+
+void TextureArray::loadLayer(int layer,const ofShortPixels &pixels) {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, getPixelFormat(pixels.getNumChannels()), GL_UNSIGNED_SHORT, pixels.getPixels());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::loadLayer(int layer,const ofPixels &pixels) {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, getPixelFormat(pixels.getNumChannels()), GL_UNSIGNED_BYTE, pixels.getPixels());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::loadLayer(int layer,const ofFloatPixels &pixels) {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, getPixelFormat(pixels.getNumChannels()), GL_FLOAT, pixels.getPixels());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::begin() {
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVao);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+}
+
+void TextureArray::draw() {
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 3, layers);
+}
+
+void TextureArray::end() {
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    glBindVertexArray(previousVao);
+}
+
+GLuint TextureArray::getTextureID() {
+    return texture;
+}
+
+int TextureArray::getWidth() {
+    return width;
+}
+
+int TextureArray::getHeight() {
+    return height;
+}
+
+int TextureArray::getNumLayers() {
+    return layers;
+}
@@ -0,0 +1,54 @@
+//
+//  TextureArray.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "Shaders.h"
+
+// a GL_TEXTURE_2D_ARRAY with one layer per sensor, usable both as the input of the
+// array shaders and as their layered render target
+class TextureArray {
+public:
+    
+    TextureArray();
+    ~TextureArray();
+    
+    // output arrays rendered by the array shaders
+    void allocate(int width,int height,int layers,ShaderFormat format=SHADER_FORMAT_RGBA8);
+    // input arrays, GL_R16 or GL_R32F keep the full precision of 16 bit depth
+    void allocate(int width,int height,int layers,GLint internalFormat);
+    
+    void loadLayer(int layer,const ofShortPixels &pixels);
+    void loadLayer(int layer,const ofPixels &pixels);
+    void loadLayer(int layer,const ofFloatPixels &pixels);
+    
+    // renders all layers with an array shader, bind its textures and uniforms in between
+    void begin();
+    void draw();
+    void end();
+    
+    GLuint getTextureID();
+    int getWidth();
+    int getHeight();
+    int getNumLayers();
+    
+private:
+    
+    void release();
+    
+    int width;
+    int height;
+    int layers;
+    
+    GLuint texture;
+    GLuint fbo;
+    GLuint vao;
+    
+    GLint previousFbo;
+    GLint previousViewport[4];
+    GLint previousVao;
+};
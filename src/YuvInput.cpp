@@ -0,0 +1,186 @@
+//
+//  YuvInput.cpp
+//  depthBlur
+//
+//
+
+#include "YuvInput.h"
+
+#define STRINGIFY(A) #A
+
+YuvInput::YuvInput() {
+    width = 0;
+    height = 0;
+    format = YUV_FORMAT_NV12;
+}
+
+void YuvInput::setup(int width,int height,YuvFormat format) {
+    this->width = width;
+    this->height = height;
+    this->format = format;
+    
+    if (format==YUV_FORMAT_NV12) {
+        yTex.allocate(width, height, GL_R8);
+        uvTex.allocate((width+1)/2, (height+1)/2, GL_RG8);
+    } else {
+        // luma filters linearly across the pairs, chroma is read with texelFetch
+        yTex.allocate(width, height, GL_RG8);
+    }
+}
+
+void YuvInput::loadData(const unsigned char *data) {
+    if (format==YUV_FORMAT_NV12) {
+        yTex.loadData(data, width, height, GL_RED);
+        uvTex.loadData(data+width*height, (width+1)/2, (height+1)/2, GL_RG);
+    } else {
+        yTex.loadData(data, width, height, GL_RG);
+    }
+}
+
+void YuvInput::setUniformTextures(ofShader &shader,int textureLocation) {
+    shader.setUniformTexture("yTex", yTex, textureLocation);
+    if (format==YUV_FORMAT_NV12) {
+        shader.setUniformTexture("uvTex", uvTex, textureLocation+1);
+    }
+}
+
+ofTexture &YuvInput::getYTexture() {
+    return yTex;
+}
+
+ofTexture &YuvInput::getUVTexture() {
+    return uvTex;
+}
+
+YuvFormat YuvInput::getFormat() {
+    return format;
+}
+
+int YuvInput::getWidth() {
+    return width;
+}
+
+int YuvInput::getHeight() {
+    return height;
+}
+
+int YuvInput::getFrameBytes() {
+    if (format==YUV_FORMAT_NV12) {
+        return width*height+(width+1)/2*((height+1)/2)*2;
+    }
+    return width*height*2;
+}
+
+static string getYuvHeader(YuvFormat format,bool luma) {
+    stringstream header;
+    header << "uniform sampler2D yTex;\n";
+    if (format==YUV_FORMAT_NV12 && !luma) {
+        header << "uniform sampler2D uvTex;\n";
+    }
+    
+    header << STRINGIFY(
+                        float yuvLuma(float y) {
+                            return clamp((y-0.0627451)*1.164384,0.0,1.0);
+                        }
+                        vec4 yuvLuma(vec4 y) {
+                            return clamp((y-0.0627451)*1.164384,0.0,1.0);
+                        }
+                        );
+    
+    if (luma) {
+        header << STRINGIFY(
+                            vec4 yuvColor(float y,vec2 uv) {
+                                return vec4(vec3(yuvLuma(y)),1.0);
+                            }
+                            );
+    } else {
+        if (format==YUV_FORMAT_NV12) {
+            header << STRINGIFY(
+                                vec2 yuvChroma(vec2 uv) {
+                                    return texture(uvTex,uv).rg;
+                                }
+                                );
+        } else {
+            header << STRINGIFY(
+                                vec2 yuvPair(int i,int row) {
+                                    int x = 2*clamp(i,0,textureSize(yTex,0).x/2-1);
+                                    return vec2(texelFetch(yTex,ivec2(x,row),0).g,texelFetch(yTex,ivec2(x+1,row),0).g);
+                                }
+                                
+                                // linear between the centers of the pairs like the NV12 chroma plane
+                                vec2 yuvChroma(vec2 uv) {
+                                    ivec2 size = textureSize(yTex,0);
+                                    int row = clamp(int(uv.y*size.y),0,size.y-1);
+                                    float x = uv.x*float(size.x/2)-0.5;
+                                    int i = int(floor(x));
+                                    return mix(yuvPair(i,row),yuvPair(i+1,row),x-float(i));
+                                }
+                                );
+        }
+        header << STRINGIFY(
+                            vec4 yuvColor(float y,vec2 uv) {
+                                vec2 c = (yuvChroma(uv)-0.5019608)*1.138393;
+                                float l = (y-0.0627451)*1.164384;
+                                vec3 rgb = vec3(l+1.402*c.y,l-0.344136*c.x-0.714136*c.y,l+1.772*c.x);
+                                return vec4(clamp(rgb,0.0,1.0),1.0);
+                            }
+                            );
+    }
+    
+    header << STRINGIFY(
+                        vec4 yuvTexture(vec2 uv) {
+                            return yuvColor(texture(yTex,uv).r,uv);
+                        }
+                        vec4 yuvTexelFetch(ivec2 p,int lod) {
+                            return yuvColor(texelFetch(yTex,p,lod).r,(vec2(p)+0.5)/vec2(textureSize(yTex,0)));
+                        }
+                        );
+    
+    // offsets have to stay constant expressions, gathers need the extension of the effect
+    header << "\n#define yuvTextureOffset(uv,offset) yuvColor(textureOffset(yTex,uv,offset).r,(uv)+vec2(offset)/vec2(textureSize(yTex,0)))\n";
+    header << "#define yuvGather(uv) yuvLuma(textureGather(yTex,uv))\n";
+    header << "#define yuvGatherOffset(uv,offset) yuvLuma(textureGatherOffset(yTex,uv,offset))\n";
+    
+    return header.str();
+}
+
+static void replaceAll(string &source,string from,string to) {
+    size_t pos = source.find(from);
+    while (pos!=string::npos) {
+        source.replace(pos, from.size(), to);
+        pos = source.find(from, pos+to.size());
+    }
+}
+
+string getYuvFragment(const string &source,const string &textureName,YuvFormat format,bool luma) {
+    string fragment = source;
+    string declaration = "uniform sampler2D " + textureName + ";";
+    size_t pos = fragment.find(declaration);
+    if (pos==string::npos) {
+        ofLogError("YuvInput") << "getYuvFragment: " << declaration << " not found";
+        return fragment;
+    }
+    fragment.replace(pos, declaration.size(), getYuvHeader(format, luma));
+    
+    replaceAll(fragment, "textureSize(" + textureName + ",", "textureSize(yTex,");
+    replaceAll(fragment, "texture(" + textureName + ",", "yuvTexture(");
+    replaceAll(fragment, "textureOffset(" + textureName + ",", "yuvTextureOffset(");
+    replaceAll(fragment, "texelFetch(" + textureName + ",", "yuvTexelFetch(");
+    replaceAll(fragment, "textureGather(" + textureName + ",", "yuvGather(");
+    replaceAll(fragment, "textureGatherOffset(" + textureName + ",", "yuvGatherOffset(");
+    
+    if (fragment.find(textureName)!=string::npos) {
+        ofLogWarning("YuvInput") << "getYuvFragment: " << textureName << " still used after rewriting";
+    }
+    
+    return fragment;
+}
+
+void createYuvShader(ofShader &shader,const string &fragment,const string &textureName,YuvFormat format,bool luma) {
+    createSimpleShader(shader,getYuvFragment(fragment, textureName, format, luma));
+}
+
+void createYuvColor2GrayShader(ofShader &shader,YuvFormat format,ShaderFormat output) {
+    // the BT.601 weights of color2gray are the luma itself
+    createYuvShader(shader, getColor2GrayFragment(output), "tex0", format, true);
+}
@@ -0,0 +1,51 @@
+//
+//  YuvInput.h
+//  depthBlur
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "Shaders.h"
+
+enum YuvFormat {
+    YUV_FORMAT_NV12, // Y plane, then interleaved UV at half width and height
+    YUV_FORMAT_YUYV  // Y0 U Y1 V per pixel pair
+};
+
+// camera frames uploaded as they arrive, without converting to rgb on the cpu:
+// NV12 as an R8 luma and an RG8 half resolution chroma texture (1.5 bytes per pixel),
+// YUYV as one RG8 texture of luma/chroma pairs (2 bytes per pixel)
+class YuvInput {
+public:
+    
+    YuvInput();
+    
+    void setup(int width,int height,YuvFormat format);
+    void loadData(const unsigned char *data); // one frame of getFrameBytes
+    void setUniformTextures(ofShader &shader,int textureLocation=0); // yTex and uvTex, between begin and end
+    
+    ofTexture &getYTexture();
+    ofTexture &getUVTexture(); // NV12 only
+    YuvFormat getFormat();
+    int getWidth();
+    int getHeight();
+    int getFrameBytes();
+    
+private:
+    
+    int width;
+    int height;
+    YuvFormat format;
+    
+    ofTexture yTex;
+    ofTexture uvTex;
+};
+
+// the fragment with textureName replaced by yTex/uvTex sampled as BT.601 video range,
+// texture, textureOffset, texelFetch and textureSize are rewritten, textureGather reads luma.
+// luma samples only the Y plane and returns gray, for effects using luma alone
+string getYuvFragment(const string &source,const string &textureName,YuvFormat format,bool luma=false);
+void createYuvShader(ofShader &shader,const string &fragment,const string &textureName,YuvFormat format,bool luma=false);
+void createYuvColor2GrayShader(ofShader &shader,YuvFormat format,ShaderFormat output=SHADER_FORMAT_RGBA8);
@@ -0,0 +1,846 @@
+//
+//  main.cpp
+//  tests
+//
+//  renders the effects of Shaders.h on fixed synthetic inputs in a software gl context
+//  and checks each one against its cpu reference (ShaderReference), its golden image in
+//  data/golden and its time in data/baseline.txt. exits with 1 when a check fails,
+//  --update records the goldens and the baseline of the current tree instead.
+//  region_scissor checks the RegionOfInterest scissor against the tiles it draws.
+//  distance_morphology erodes and dilates the mask disc through DistanceField.
+//  the software rasterizer runs on the cpu, so a pass is timed by the wall clock up to glFinish
+//
+
+#include "ofMain.h"
+#include "Shaders.h"
+#include "ShaderChain.h"
+#include "ShaderReference.h"
+#include "RegionOfInterest.h"
+#include "DistanceField.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#define STRINGIFY(A) #A
+
+// goldens and references are rendered small, times are taken at a size the gpu notices
+#define TEST_WIDTH 64
+#define TEST_HEIGHT 48
+#define TIMING_WIDTH 512
+#define TIMING_HEIGHT 384
+#define TIMING_REPEATS 9
+
+// slower than the baseline by this factor (plus the absolute slack for timer noise) fails
+#define SLOWDOWN_TOLERANCE 1.5
+#define SLOWDOWN_SLACK 0.2
+
+enum TestInput {
+    INPUT_DEPTH,
+    INPUT_BACKGROUND,
+    INPUT_COLOR,
+    INPUT_MASK,
+    INPUT_MATTE, // color with the mask as alpha
+    NUM_INPUTS
+};
+
+struct TestInputs {
+    ofFloatPixels pixels[NUM_INPUTS];
+    ofTexture textures[NUM_INPUTS];
+};
+
+struct EffectTest {
+    string name;
+    ofPtr<ofShader> shader;
+    ShaderFormat format;
+    vector<pair<string,TestInput> > textures;
+    map<string,float> floats;
+    map<string,int> ints;
+    ofVec2f dir; // in texels, (0,0) for effects without dir
+    int attachment; // color attachment read back, above 0 the pass renders into all of them
+    bool cloud; // a point per texel of INPUT_DEPTH at z = depth under identity matrices
+    ofFloatPixels reference; // unallocated without a cpu reference
+    float referenceTolerance; // half a level of the output format and rounding by default
+    int goldenTolerance; // 8 bit levels
+};
+
+static bool createContext() {
+    // llvmpipe renders the same on every machine, unlike the hardware drivers
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+
+    EGLDisplay display = EGL_NO_DISPLAY;
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+#endif
+    if (display==EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint major,minor;
+    if (!eglInitialize(display, &major, &minor) || !eglBindAPI(EGL_OPENGL_API)) {
+        return false;
+    }
+
+    EGLint attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION_KHR,3,
+        EGL_CONTEXT_MINOR_VERSION_KHR,3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+    if (context==EGL_NO_CONTEXT) {
+        return false;
+    }
+    return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+// deterministic on every platform, unlike rand()
+static float getNoise(unsigned &seed) {
+    seed = seed*1664525u+1013904223u;
+    return (seed>>8)/16777216.0;
+}
+
+static void setTexel(ofFloatPixels &pixels,int x,int y,float r,float g,float b) {
+    float *texel = pixels.getPixels()+(y*pixels.getWidth()+x)*4;
+    texel[0] = r;
+    texel[1] = g;
+    texel[2] = b;
+    texel[3] = 1.0;
+}
+
+static void setupInputs(TestInputs &inputs,int width,int height) {
+    unsigned seed = 1;
+    for (int i=0;i<NUM_INPUTS;i++) {
+        inputs.pixels[i].allocate(width, height, 4);
+    }
+
+    for (int y=0;y<height;y++) {
+        for (int x=0;x<width;x++) {
+            // coordinates of the small size so both sizes show the same scene
+            float u = (float)x*TEST_WIDTH/width;
+            float v = (float)y*TEST_HEIGHT/height;
+
+            float bg = 0.5+0.3*sin(u*0.21)*cos(v*0.17)+0.05*getNoise(seed);
+            bool foreground = u>20 && u<44 && v>12 && v<36;
+            float depth = foreground ? 0.3+0.02*getNoise(seed) : bg;
+            setTexel(inputs.pixels[INPUT_DEPTH], x, y, depth, depth, depth);
+            setTexel(inputs.pixels[INPUT_BACKGROUND], x, y, bg, bg, bg);
+
+            setTexel(inputs.pixels[INPUT_COLOR], x, y, 0.5+0.5*sin(u*0.13), 0.5+0.5*cos(v*0.11), getNoise(seed));
+
+            float mask = (u-32)*(u-32)+(v-24)*(v-24)<16*16 ? 1.0 : 0.0;
+            setTexel(inputs.pixels[INPUT_MASK], x, y, mask, mask, mask);
+            
+            float *matte = inputs.pixels[INPUT_MATTE].getPixels()+(y*width+x)*4;
+            copy(inputs.pixels[INPUT_COLOR].getPixels()+(y*width+x)*4, inputs.pixels[INPUT_COLOR].getPixels()+(y*width+x)*4+3, matte);
+            matte[3] = mask;
+        }
+    }
+
+    for (int i=0;i<NUM_INPUTS;i++) {
+        inputs.textures[i].allocate(width, height, GL_RGBA32F);
+        inputs.textures[i].setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+        inputs.textures[i].loadData(inputs.pixels[i]);
+    }
+}
+
+static EffectTest &addTest(vector<EffectTest> &tests,string name,ofShader *shader,ShaderFormat format=SHADER_FORMAT_RGBA8) {
+    tests.push_back(EffectTest());
+    EffectTest &test = tests.back();
+    test.name = name;
+    test.shader = ofPtr<ofShader>(shader);
+    test.format = format;
+    test.attachment = 0;
+    test.cloud = false;
+    test.referenceTolerance = format==SHADER_FORMAT_R16F || format==SHADER_FORMAT_RG16F ? 0.001 : 0.6/255;
+    test.goldenTolerance = 1;
+    return test;
+}
+
+static ofShader *createShader(void (*factory)(ofShader &,ShaderFormat),ShaderFormat format) {
+    ofShader *shader = new ofShader;
+    factory(*shader, format);
+    return shader;
+}
+
+static ofShader *createShader(void (*factory)(ofShader &)) {
+    ofShader *shader = new ofShader;
+    factory(*shader);
+    return shader;
+}
+
+static ofShader *createShader(void (*factory)(ofShader &,int,double),int radius,double variance) {
+    ofShader *shader = new ofShader;
+    factory(*shader, radius, variance);
+    return shader;
+}
+
+static ofShader *createShader(void (*factory)(ofShader &,int,double,ShaderFormat),int radius,double variance,ShaderFormat format) {
+    ofShader *shader = new ofShader;
+    factory(*shader, radius, variance, format);
+    return shader;
+}
+
+static ofShader *createKuwahara(int radius,bool luma) {
+    ofShader *shader = new ofShader;
+    createKuwaharaShader(*shader, radius, luma);
+    return shader;
+}
+
+// var depth blur is the fast blur where 1-depth passes offset and the input elsewhere
+static void referenceVarDepthBlur(const ofFloatPixels &src,const ofFloatPixels &depth,ofFloatPixels &dst,int radius,double variance,int dx,int dy,float offset) {
+    referenceFastBlur(src, dst, radius, variance, dx, dy);
+    for (int i=0;i<dst.size();i+=4) {
+        if (1-depth[i]<offset) {
+            for (int k=0;k<4;k++) {
+                dst[i+k] = src[i+k];
+            }
+        }
+    }
+}
+
+static void setupTests(vector<EffectTest> &tests,TestInputs &inputs) {
+    const ofFloatPixels &depth = inputs.pixels[INPUT_DEPTH];
+    const ofFloatPixels &background = inputs.pixels[INPUT_BACKGROUND];
+    const ofFloatPixels &color = inputs.pixels[INPUT_COLOR];
+    const ofFloatPixels &mask = inputs.pixels[INPUT_MASK];
+
+    EffectTest *test;
+
+    test = &addTest(tests, "depth", createShader(createDepthShader, SHADER_FORMAT_RGBA8));
+    test->textures.push_back(make_pair("tex0", INPUT_DEPTH));
+    test->floats["minEdge"] = 0.2;
+    test->floats["maxEdge"] = 0.8;
+    referenceDepth(depth, test->reference, 0.2, 0.8);
+
+    test = &addTest(tests, "depth_r16f", createShader(createDepthShader, SHADER_FORMAT_R16F), SHADER_FORMAT_R16F);
+    test->textures.push_back(make_pair("tex0", INPUT_DEPTH));
+    test->floats["minEdge"] = 0.2;
+    test->floats["maxEdge"] = 0.8;
+    referenceDepth(depth, test->reference, 0.2, 0.8);
+
+    test = &addTest(tests, "depth_mask", createShader(createDepthMaskShader, SHADER_FORMAT_RGBA8));
+    test->textures.push_back(make_pair("tex0", INPUT_DEPTH));
+    test->textures.push_back(make_pair("bgTex", INPUT_BACKGROUND));
+    test->floats["minEdge"] = 0.2;
+    test->floats["maxEdge"] = 0.8;
+    test->floats["tolerance"] = 0.05;
+    referenceDepthMask(depth, background, test->reference, 0.2, 0.8, 0.05);
+
+    test = &addTest(tests, "depth_background_subtraction", createShader(createDepthBackgroundSubtractionShader, SHADER_FORMAT_R8), SHADER_FORMAT_R8);
+    test->textures.push_back(make_pair("tex0", INPUT_DEPTH));
+    test->textures.push_back(make_pair("bgTex", INPUT_BACKGROUND));
+    test->floats["tolerance"] = 0.05;
+    referenceDepthBackgroundSubtraction(depth, background, test->reference, 0.05);
+
+    test = &addTest(tests, "color2gray", createShader(createColor2GrayShader, SHADER_FORMAT_RGBA8));
+    test->textures.push_back(make_pair("tex0", INPUT_COLOR));
+    referenceColor2Gray(color, test->reference);
+
+    test = &addTest(tests, "threshold", createShader(createThresholdShader, SHADER_FORMAT_RGBA8));
+    test->textures.push_back(make_pair("tex0", INPUT_DEPTH));
+    test->floats["edge0"] = 0.3;
+    test->floats["edge1"] = 0.6;
+    referenceThreshold(depth, test->reference, 0.3, 0.6);
+
+    test = &addTest(tests, "masking", createShader(createMaskingShader));
+    test->textures.push_back(make_pair("tex0", INPUT_COLOR));
+    test->textures.push_back(make_pair("maskTex", INPUT_MASK));
+    referenceMasking(color, mask, test->reference);
+
+    test = &addTest(tests, "inverse_masking", createShader(createInverseMaskingShader));
+    test->textures.push_back(make_pair("tex0", INPUT_COLOR));
+    test->textures.push_back(make_pair("maskTex", INPUT_MASK));
+    referenceInverseMasking(color, mask, test->reference);
+
+    test = &addTest(tests, "screen", createShader(createScreenShader));
+    test->textures.push_back(make_pair("tex0", INPUT_COLOR));
+    test->textures.push_back(make_pair("tex1", INPUT_DEPTH));
+    referenceScreen(color, depth, test->reference);
+
+    test = &addTest(tests, "dilation", createShader(createDilationShader));
+    test->textures.push_back(make_pair("tex0", INPUT_MASK));
+    referenceDilation(mask, test->reference);
+
+    // the blurs share createCoefficients with the references, so a change of the taps of
+    // one generator shows up here
+    test = &addTest(tests, "fast_blur_x", createShader(createFastBlurShader, 4, 0.2));
+    test->textures.push_back(make_pair("tex0", INPUT_COLOR));
+    test->dir = ofVec2f(1,0);
+    referenceFastBlur(color, test->reference, 4, 0.2, 1, 0);
+
+    test = &addTest(tests, "fast_blur_y", createShader(createFastBlurShader, 4, 0.2));
+    test->textures.push_back(make_pair("tex0", INPUT_COLOR));
+    test->dir = ofVec2f(0,1);
+    referenceFastBlur(color, test->reference, 4, 0.2, 0, 1);
+
+    test = &addTest(tests, "blur", createShader(createBlurShader, 3, 0.2));
+    test->textures.push_back(make_pair("tex0", INPUT_COLOR));
+    test->dir = ofVec2f(1,0);
+    referenceBlur(color, test->reference, 3, 0.2, 1, 0);
+
+    test = &addTest(tests, "depth_blur", createShader(createDepthBlurShader, 4, 0.2, SHADER_FORMAT_RGBA8));
+    test->textures.push_back(make_pair("tex0", INPUT_DEPTH));
+    test->dir = ofVec2f(0,1);
+    referenceDepthBlur(depth, test->reference, 4, 0.2, 0, 1);
+
+    test = &addTest(tests, "depth_blur_r8", createShader(createDepthBlurShader, 4, 0.2, SHADER_FORMAT_R8), SHADER_FORMAT_R8);
+    test->textures.push_back(make_pair("tex0", INPUT_DEPTH));
+    test->dir = ofVec2f(1,0);
+    referenceDepthBlur(depth, test->reference, 4, 0.2, 1, 0);
+
+    test = &addTest(tests, "var_depth_blur", createShader(createVarDepthBlurShader, 4, 0.2));
+    test->textures.push_back(make_pair("tex0", INPUT_COLOR));
+    test->textures.push_back(make_pair("depthTex", INPUT_DEPTH));
+    test->floats["scale"] = 1.0;
+    test->floats["offset"] = 0.6;
+    test->dir = ofVec2f(1,0);
+    referenceVarDepthBlur(color, depth, test->reference, 4, 0.2, 1, 0, 0.6);
+
+    test = &addTest(tests, "blend", createShader(createBlendShader));
+    test->textures.push_back(make_pair("tex0", INPUT_COLOR));
+    test->textures.push_back(make_pair("tex1", INPUT_DEPTH));
+    test->floats["alpha"] = 0.3;
+    referenceBlend(color, depth, test->reference, 0.3);
+
+    test = &addTest(tests, "echo", createShader(createEchoShader));
+    test->textures.push_back(make_pair("tex0", INPUT_COLOR));
+    test->textures.push_back(make_pair("tex1", INPUT_DEPTH));
+    test->floats["alpha"] = 0.3;
+    referenceEcho(color, depth, test->reference, 0.3);
+
+    // bits 0, 1, 2 and 4, the unset bit drops the background
+    test = &addTest(tests, "screen_multiple", createShader(createScreenMultipleShader));
+    test->textures.push_back(make_pair("tex0", INPUT_COLOR));
+    test->textures.push_back(make_pair("tex1", INPUT_DEPTH));
+    test->textures.push_back(make_pair("tex2", INPUT_MASK));
+    test->textures.push_back(make_pair("tex3", INPUT_BACKGROUND));
+    test->textures.push_back(make_pair("tex4", INPUT_COLOR));
+    test->ints["mask"] = 23;
+    vector<const ofFloatPixels *> layers;
+    layers.push_back(&color);
+    layers.push_back(&depth);
+    layers.push_back(&mask);
+    layers.push_back(&background);
+    layers.push_back(&color);
+    referenceScreenMultiple(layers, test->reference, 23);
+
+    test = &addTest(tests, "hsl", createShader(createHSLShader));
+    test->textures.push_back(make_pair("tex0", INPUT_DEPTH));
+    test->floats["hue"] = 0.3;
+    test->floats["sat"] = 0.8;
+    test->floats["offset"] = 0.05;
+    referenceHSL(depth, test->reference, 0.3, 0.8, 0.05);
+
+    // a strobe frame, the mask lights its circle and the previous frame decays elsewhere
+    ofFloatPixels strobeHue;
+    test = &addTest(tests, "strobe", createShader(createStrobeShader), SHADER_FORMAT_R8);
+    test->textures.push_back(make_pair("tex0", INPUT_MASK));
+    test->textures.push_back(make_pair("tex1", INPUT_DEPTH));
+    test->textures.push_back(make_pair("tex2", INPUT_BACKGROUND));
+    test->ints["frameNum"] = 40;
+    test->ints["strobeRate"] = 4;
+    test->floats["decay"] = 0.9;
+    test->attachment = 1;
+    referenceStrobe(mask, depth, background, test->reference, strobeHue, 40, 4, 0.9);
+
+    test = &addTest(tests, "strobe_hue", createShader(createStrobeShader), SHADER_FORMAT_R8);
+    test->textures = tests[tests.size()-2].textures;
+    test->ints = tests[tests.size()-2].ints;
+    test->floats = tests[tests.size()-2].floats;
+    test->reference = strobeHue;
+
+    test = &addTest(tests, "cloud", createShader(createCloudShader));
+    test->floats["minEdge"] = 0.2;
+    test->floats["maxEdge"] = 0.8;
+    test->floats["scale"] = 1.0;
+    test->cloud = true;
+    referenceCloud(depth, test->reference, 0.2, 0.8, 1.0);
+
+    test = &addTest(tests, "border", createShader(createBorderShader));
+    test->textures.push_back(make_pair("tex0", INPUT_MATTE));
+    referenceBorder(inputs.pixels[INPUT_MATTE], test->reference);
+
+    test = &addTest(tests, "kuwahara3", createKuwahara(3, false));
+    test->textures.push_back(make_pair("inputImageTexture", INPUT_COLOR));
+    referenceKuwahara(color, test->reference, 3);
+
+    test = &addTest(tests, "kuwahara3_luma", createKuwahara(3, true));
+    test->textures.push_back(make_pair("inputImageTexture", INPUT_DEPTH));
+    referenceKuwahara(depth, test->reference, 3);
+
+    // the original shaders the generator replaced, with radius as a uniform and unrolled
+    test = &addTest(tests, "kuwahara_radius", createShader(createKuwaharaShader));
+    test->textures.push_back(make_pair("inputImageTexture", INPUT_COLOR));
+    test->ints["radius"] = 3;
+    referenceKuwahara(color, test->reference, 3);
+
+    test = &addTest(tests, "kuwahara3_unrolled", createShader(createKuwahara3Shader));
+    test->textures.push_back(make_pair("inputImageTexture", INPUT_COLOR));
+    referenceKuwahara(color, test->reference, 3);
+
+    // no cpu reference, the golden image alone guards it
+    test = &addTest(tests, "halftone", createShader(createHalftoneShader));
+    test->textures.push_back(make_pair("src_tex_unit0", INPUT_COLOR));
+    test->floats["rotation"] = 0.3;
+}
+
+// readback of a gray target as the swizzle presents it to the next pass
+static void readOutput(ofTexture &texture,ShaderFormat format,ofFloatPixels &pixels) {
+    pixels.allocate(texture.getWidth(), texture.getHeight(), 4);
+    ofTextureData &data = texture.getTextureData();
+    glBindTexture(data.textureTarget, data.textureID);
+    glGetTexImage(data.textureTarget, 0, GL_RGBA, GL_FLOAT, pixels.getPixels());
+    glBindTexture(data.textureTarget, 0);
+
+    int channels = getFormatChannels(format);
+    if (channels<4) {
+        for (int i=0;i<pixels.size();i+=4) {
+            pixels[i+3] = channels==2 ? pixels[i+1] : 1.0;
+            pixels[i+1] = pixels[i+2] = pixels[i];
+        }
+    }
+}
+
+// the passes ShaderChain has no room for, a point cloud or an output past the first,
+// render straight into an fbo with all the attachments as draw buffers
+static float renderDirect(EffectTest &test,TestInputs &inputs,int width,int height,ofFloatPixels *output) {
+    ofFbo::Settings settings;
+    settings.width = width;
+    settings.height = height;
+    settings.numColorbuffers = test.attachment+1;
+    settings.internalformat = getFormatInternal(test.format);
+    ofFbo fbo;
+    fbo.allocate(settings);
+
+    ofMesh mesh;
+    if (test.cloud) {
+        // a point at the center of each texel, identity matrices pass the depth on as clip z
+        const ofFloatPixels &depth = inputs.pixels[INPUT_DEPTH];
+        mesh.setMode(OF_PRIMITIVE_POINTS);
+        for (int y=0;y<height;y++) {
+            for (int x=0;x<width;x++) {
+                mesh.addVertex(ofVec3f((x+0.5)*2/width-1, (y+0.5)*2/height-1, depth[(y*width+x)*4]));
+            }
+        }
+    } else {
+        mesh.setMode(OF_PRIMITIVE_TRIANGLE_FAN);
+        mesh.addVertex(ofVec3f(0,0));
+        mesh.addTexCoord(ofVec2f(0,0));
+        mesh.addVertex(ofVec3f(width,0));
+        mesh.addTexCoord(ofVec2f(1,0));
+        mesh.addVertex(ofVec3f(width,height));
+        mesh.addTexCoord(ofVec2f(1,1));
+        mesh.addVertex(ofVec3f(0,height));
+        mesh.addTexCoord(ofVec2f(0,1));
+    }
+
+    vector<float> times;
+    int repeats = output ? 1 : TIMING_REPEATS;
+    for (int i=0;i<repeats;i++) {
+        glFinish();
+        unsigned long long start = ofGetElapsedTimeMicros();
+        fbo.begin();
+        fbo.activateAllDrawBuffers();
+        ofClear(0, 0, 0, 0);
+        if (test.cloud) {
+            ofSetMatrixMode(OF_MATRIX_PROJECTION);
+            ofLoadIdentityMatrix();
+            ofSetMatrixMode(OF_MATRIX_MODELVIEW);
+            ofLoadIdentityMatrix();
+        }
+        test.shader->begin();
+        int unit = 0;
+        for (vector<pair<string,TestInput> >::iterator iter=test.textures.begin();iter!=test.textures.end();iter++) {
+            test.shader->setUniformTexture(iter->first, inputs.textures[iter->second], unit++);
+        }
+        for (map<string,float>::iterator iter=test.floats.begin();iter!=test.floats.end();iter++) {
+            test.shader->setUniform1f(iter->first, iter->second);
+        }
+        for (map<string,int>::iterator iter=test.ints.begin();iter!=test.ints.end();iter++) {
+            test.shader->setUniform1i(iter->first, iter->second);
+        }
+        mesh.draw();
+        test.shader->end();
+        fbo.end();
+        glFinish();
+        times.push_back((ofGetElapsedTimeMicros()-start)/1000.0);
+    }
+    sort(times.begin(), times.end());
+
+    if (output) {
+        readOutput(fbo.getTextureReference(test.attachment), test.format, *output);
+    }
+    return times[times.size()/2];
+}
+
+// median time of the pass, output read back when not NULL
+static float render(EffectTest &test,TestInputs &inputs,int width,int height,ofFloatPixels *output) {
+    if (test.attachment || test.cloud) {
+        return renderDirect(test, inputs, width, height, output);
+    }
+
+    ShaderChain chain;
+    chain.setup(width, height);
+    vector<int> sources;
+    for (int i=0;i<NUM_INPUTS;i++) {
+        sources.push_back(chain.addInput(inputs.textures[i]));
+    }
+
+    int pass = chain.addPass(*test.shader, test.format);
+    for (vector<pair<string,TestInput> >::iterator iter=test.textures.begin();iter!=test.textures.end();iter++) {
+        chain.setTexture(pass, iter->first, sources[iter->second]);
+    }
+    for (map<string,float>::iterator iter=test.floats.begin();iter!=test.floats.end();iter++) {
+        chain.setUniform(pass, iter->first, iter->second);
+    }
+    for (map<string,int>::iterator iter=test.ints.begin();iter!=test.ints.end();iter++) {
+        chain.setUniform(pass, iter->first, iter->second);
+    }
+    if (test.dir.x!=0 || test.dir.y!=0) {
+        chain.setUniform(pass, "dir", test.dir.x/width, test.dir.y/height);
+    }
+    chain.allocate();
+
+    vector<float> times;
+    int repeats = output ? 1 : TIMING_REPEATS;
+    for (int i=0;i<repeats;i++) {
+        glFinish();
+        unsigned long long start = ofGetElapsedTimeMicros();
+        chain.update();
+        glFinish();
+        times.push_back((ofGetElapsedTimeMicros()-start)/1000.0);
+    }
+    sort(times.begin(), times.end());
+
+    if (output) {
+        readOutput(chain.getTexture(pass), test.format, *output);
+    }
+    return times[times.size()/2];
+}
+
+// a mask blob off centre in y, the scissor of its region has to cover exactly the box of the
+// tiles draw() lights, which a scissor left in flipped coordinates would miss
+static bool testRegionScissor(stringstream &report) {
+    ofFloatPixels mask;
+    mask.allocate(TEST_WIDTH, TEST_HEIGHT, 4);
+    for (int y=0;y<TEST_HEIGHT;y++) {
+        for (int x=0;x<TEST_WIDTH;x++) {
+            float value = (x-40)*(x-40)+(y-8)*(y-8)<5*5 ? 1.0 : 0.0;
+            setTexel(mask, x, y, value, value, value);
+        }
+    }
+    ofTexture maskTexture;
+    maskTexture.allocate(TEST_WIDTH, TEST_HEIGHT, GL_RGBA32F);
+    maskTexture.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+    maskTexture.loadData(mask);
+
+    RegionOfInterest region;
+    region.setup(TEST_WIDTH, TEST_HEIGHT, 16, 0);
+    region.setThreshold(0.5);
+    region.update(maskTexture);
+    region.resolve();
+
+    ofShader white;
+    createSimpleShader(white, STRINGIFY(
+                                        \n#version 150\n
+                                        out vec4 fragColor;
+                                        void main(void) {
+                                            fragColor = vec4(1.0);
+                                        }
+                                        ));
+
+    ofFbo tiles;
+    ofFbo scissor;
+    allocateTarget(tiles, TEST_WIDTH, TEST_HEIGHT, SHADER_FORMAT_RGBA8);
+    allocateTarget(scissor, TEST_WIDTH, TEST_HEIGHT, SHADER_FORMAT_RGBA8);
+
+    tiles.begin();
+    ofClear(0, 0, 0, 0);
+    white.begin();
+    region.draw();
+    white.end();
+    tiles.end();
+
+    scissor.begin();
+    ofClear(0, 0, 0, 0);
+    region.begin();
+    ofClear(255, 255, 255, 255);
+    region.end();
+    scissor.end();
+
+    ofFloatPixels tilePixels;
+    ofFloatPixels scissorPixels;
+    readOutput(tiles.getTextureReference(), SHADER_FORMAT_RGBA8, tilePixels);
+    readOutput(scissor.getTextureReference(), SHADER_FORMAT_RGBA8, scissorPixels);
+
+    int x0 = TEST_WIDTH;
+    int y0 = TEST_HEIGHT;
+    int x1 = 0;
+    int y1 = 0;
+    int uncovered = 0;
+    for (int y=0;y<TEST_HEIGHT;y++) {
+        for (int x=0;x<TEST_WIDTH;x++) {
+            int i = (y*TEST_WIDTH+x)*4;
+            if (tilePixels[i]>0.5) {
+                x0 = min(x0,x);
+                y0 = min(y0,y);
+                x1 = max(x1,x+1);
+                y1 = max(y1,y+1);
+            } else if (mask[i]>0.5) {
+                uncovered++;
+            }
+        }
+    }
+
+    int wrong = 0;
+    for (int y=0;y<TEST_HEIGHT;y++) {
+        for (int x=0;x<TEST_WIDTH;x++) {
+            bool inside = x>=x0 && x<x1 && y>=y0 && y<y1;
+            wrong += inside!=(scissorPixels[(y*TEST_WIDTH+x)*4]>0.5);
+        }
+    }
+
+    report << "\ttiles " << region.getNumActiveTiles() << "/" << region.getNumTiles();
+    report << "\tmask outside tiles " << uncovered << "\tscissor off " << wrong;
+    return region.getNumActiveTiles()>0 && region.getNumActiveTiles()<region.getNumTiles() && !uncovered && !wrong;
+}
+
+// the nearest texel on the other side of the mask edge from each texel, brute force
+static float getEdgeDistance(const ofFloatPixels &mask,int x,int y) {
+    bool inside = mask[(y*TEST_WIDTH+x)*4]>0.5;
+    float best = 1e9;
+    for (int j=0;j<TEST_HEIGHT;j++) {
+        for (int i=0;i<TEST_WIDTH;i++) {
+            if ((mask[(j*TEST_WIDTH+i)*4]>0.5)!=inside) {
+                best = min(best,(float)sqrt((float)(i-x)*(i-x)+(j-y)*(j-y)));
+            }
+        }
+    }
+    return best;
+}
+
+// erodes and dilates the mask disc by the same radius through DistanceField, erosion has to
+// drop the texels within radius of the outside and dilation add those within radius of the
+// mask. no texel lies at the radius, so the half level of a tie can't decide either way
+static bool testDistanceMorphology(const ofFloatPixels &mask,stringstream &report) {
+    const float radius = 3.5;
+    
+    ofTexture maskTexture;
+    maskTexture.allocate(TEST_WIDTH, TEST_HEIGHT, GL_RGBA32F);
+    maskTexture.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+    maskTexture.loadData(mask);
+    
+    DistanceField field;
+    field.setup(TEST_WIDTH, TEST_HEIGHT);
+    field.update(maskTexture);
+    
+    ofShader erosion;
+    ofShader dilation;
+    createDistanceErosionShader(erosion);
+    createDistanceDilationShader(dilation);
+    
+    ShaderChain chain;
+    chain.setup(TEST_WIDTH, TEST_HEIGHT);
+    int distance = chain.addInput(field.getTexture());
+    int passes[2] = {chain.addPass(erosion), chain.addPass(dilation)};
+    for (int i=0;i<2;i++) {
+        chain.setTexture(passes[i], "distTex", distance);
+        chain.setUniform(passes[i], "radius", radius);
+        chain.keep(passes[i]);
+    }
+    chain.allocate();
+    chain.update();
+    
+    ofFloatPixels eroded;
+    ofFloatPixels dilated;
+    readOutput(chain.getTexture(passes[0]), SHADER_FORMAT_RGBA8, eroded);
+    readOutput(chain.getTexture(passes[1]), SHADER_FORMAT_RGBA8, dilated);
+    
+    int wrongEroded = 0;
+    int wrongDilated = 0;
+    for (int y=0;y<TEST_HEIGHT;y++) {
+        for (int x=0;x<TEST_WIDTH;x++) {
+            int i = (y*TEST_WIDTH+x)*4;
+            bool inside = mask[i]>0.5;
+            float d = getEdgeDistance(mask, x, y);
+            wrongEroded+=(eroded[i]>0.5)!=(inside && d>radius);
+            wrongDilated+=(dilated[i]>0.5)!=(inside || d<=radius);
+        }
+    }
+    
+    report << "	eroded off " << wrongEroded << "	dilated off " << wrongDilated;
+    return !wrongEroded && !wrongDilated;
+}
+
+static void quantize(const ofFloatPixels &pixels,ofPixels &quantized) {
+    quantized.allocate(pixels.getWidth(), pixels.getHeight(), 4);
+    for (int i=0;i<pixels.size();i++) {
+        quantized[i] = ofClamp(pixels[i]*255+0.5, 0, 255);
+    }
+}
+
+// binary PAM, rgba 8 bit
+static bool saveGolden(string path,const ofPixels &pixels) {
+    ofstream file(ofToDataPath(path).c_str(), ios::binary);
+    if (!file) {
+        return false;
+    }
+    file << "P7\nWIDTH " << pixels.getWidth() << "\nHEIGHT " << pixels.getHeight();
+    file << "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+    file.write((const char *)pixels.getPixels(), pixels.size());
+    return file.good();
+}
+
+static bool loadGolden(string path,ofPixels &pixels) {
+    ifstream file(ofToDataPath(path).c_str(), ios::binary);
+    string token;
+    int width = 0;
+    int height = 0;
+    while (file >> token && token!="ENDHDR") {
+        if (token=="WIDTH") {
+            file >> width;
+        } else if (token=="HEIGHT") {
+            file >> height;
+        }
+    }
+    file.get(); // newline after ENDHDR
+    if (!file || width==0 || height==0) {
+        return false;
+    }
+    pixels.allocate(width, height, 4);
+    file.read((char *)pixels.getPixels(), pixels.size());
+    return file.good();
+}
+
+static int getGoldenDifference(const ofPixels &pixels,const ofPixels &golden) {
+    if (pixels.size()!=golden.size()) {
+        return 255;
+    }
+    int difference = 0;
+    for (int i=0;i<pixels.size();i++) {
+        difference = max(difference,abs((int)pixels[i]-(int)golden[i]));
+    }
+    return difference;
+}
+
+static map<string,float> loadBaseline(string path) {
+    map<string,float> baseline;
+    ifstream file(ofToDataPath(path).c_str());
+    string name;
+    float millis;
+    while (file >> name >> millis) {
+        baseline[name] = millis;
+    }
+    return baseline;
+}
+
+static void saveBaseline(string path,const map<string,float> &baseline) {
+    ofstream file(ofToDataPath(path).c_str());
+    for (map<string,float>::const_iterator iter=baseline.begin();iter!=baseline.end();iter++) {
+        file << iter->first << " " << iter->second << endl;
+    }
+}
+
+int main(int argc,char *argv[]) {
+    bool update = argc>1 && string(argv[1])=="--update";
+
+    if (!createContext()) {
+        cerr << "no software gl context" << endl;
+        return 1;
+    }
+    glewExperimental = GL_TRUE;
+    glewInit();
+    ofPtr<ofGLProgrammableRenderer> renderer(new ofGLProgrammableRenderer(false));
+    ofSetCurrentRenderer(renderer);
+    renderer->setup();
+
+    TestInputs inputs;
+    TestInputs timingInputs;
+    setupInputs(inputs, TEST_WIDTH, TEST_HEIGHT);
+    setupInputs(timingInputs, TIMING_WIDTH, TIMING_HEIGHT);
+
+    vector<EffectTest> tests;
+    setupTests(tests, inputs);
+
+    map<string,float> baseline = loadBaseline("baseline.txt");
+    map<string,float> times;
+    int failures = 0;
+
+    for (vector<EffectTest>::iterator iter=tests.begin();iter!=tests.end();iter++) {
+        stringstream report;
+        bool passed = iter->shader->isLoaded();
+        report << iter->name;
+
+        ofFloatPixels output;
+        render(*iter, inputs, TEST_WIDTH, TEST_HEIGHT, &output);
+        float millis = render(*iter, timingInputs, TIMING_WIDTH, TIMING_HEIGHT, NULL);
+        times[iter->name] = millis;
+
+        if (iter->reference.size()) {
+            float difference = getMaxDifference(output, iter->reference);
+            report << "\treference " << difference;
+            if (difference>iter->referenceTolerance) {
+                report << " > " << iter->referenceTolerance;
+                passed = false;
+            }
+        }
+
+        ofPixels quantized;
+        quantize(output, quantized);
+        string goldenPath = "golden/" + iter->name + ".pam";
+        if (update) {
+            if (!saveGolden(goldenPath, quantized)) {
+                report << "\tcan't write " << goldenPath;
+                passed = false;
+            }
+        } else {
+            ofPixels golden;
+            if (!loadGolden(goldenPath, golden)) {
+                report << "\tno " << goldenPath << " (--update records it)";
+                passed = false;
+            } else {
+                int difference = getGoldenDifference(quantized, golden);
+                report << "\tgolden " << difference;
+                if (difference>iter->goldenTolerance) {
+                    report << " > " << iter->goldenTolerance;
+                    passed = false;
+                }
+            }
+        }
+
+        report << "\t" << millis << " ms";
+        if (!update && baseline.count(iter->name)) {
+            float limit = baseline[iter->name]*SLOWDOWN_TOLERANCE+SLOWDOWN_SLACK;
+            report << " (baseline " << baseline[iter->name] << ")";
+            if (millis>limit) {
+                report << " > " << limit;
+                passed = false;
+            }
+        }
+
+        cout << (passed ? "PASS " : "FAIL ") << report.str() << endl;
+        failures+=!passed;
+    }
+
+    stringstream report;
+    bool passed = testRegionScissor(report);
+    cout << (passed ? "PASS " : "FAIL ") << "region_scissor" << report.str() << endl;
+    failures+=!passed;
+    
+    report.str("");
+    passed = testDistanceMorphology(inputs.pixels[INPUT_MASK], report);
+    cout << (passed ? "PASS " : "FAIL ") << "distance_morphology" << report.str() << endl;
+    failures+=!passed;
+    int numChecks = tests.size()+2;
+
+    if (update) {
+        saveBaseline("baseline.txt", times);
+        cout << "recorded " << tests.size() << " goldens and baseline.txt" << endl;
+    }
+
+    cout << numChecks-failures << "/" << numChecks << " passed" << endl;
+    return failures ? 1 : 0;
+}